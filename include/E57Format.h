@@ -32,6 +32,7 @@
 //! @file  E57Format.h Header file for the E57 API.
 
 #include <cfloat>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -130,6 +131,81 @@ namespace e57
 
    //!@}
 
+   //! @brief Options used when opening an ImageFile
+   //! @details Each option only applies when either reading or writing and is ignored otherwise.
+   //! @see ImageFile::ImageFile( const ustring &, const ustring &, const ImageFileOptions & )
+   struct E57_DLL ImageFileOptions
+   {
+      //! Set how frequently to verify the checksums (see ReadChecksumPolicy). (Reading only.)
+      ReadChecksumPolicy checksumPolicy = ChecksumPolicy::All;
+
+      //! Map the whole file into memory instead of reading it through a file descriptor.
+      //! This avoids copying through system calls and works best when the file is already in the OS page cache.
+      //! If the file cannot be mapped (e.g. it is too large for the address space), normal reads are used.
+      //! (Reading only.)
+      bool memoryMapped = false;
+
+      //! Number of bytes to use for caching compressed vector data packets. The cache belongs to the ImageFile and
+      //! is shared by all of its CompressedVectorReaders, so several readers of the same data don't each read it
+      //! again. Readers open at the same time share these bytes, though each can always hold one packet (up to
+      //! 64 KiB). Memory is only allocated as packets are read. (Reading only.)
+      size_t packetCacheSize = 2 * 1024 * 1024;
+
+      //! Number of data packets each CompressedVectorReader reads ahead on a background thread while decoding the
+      //! current one, so I/O overlaps decoding. 0 (the default) reads packets only when they are needed. (Reading
+      //! only.)
+      unsigned readAheadPacketCount = 0;
+
+      //! Path of a sidecar file to keep packet indexes in. When seeking in a compressed vector written without index
+      //! packets, the packet headers are scanned to build an index. With a path set, the index is saved there and
+      //! loaded again the next time the file is opened, so the scan only happens once. The sidecar is ignored and
+      //! rewritten if the file's size, modification time, or GUID have changed, and isn't used at all if the
+      //! modification time can't be found. (Reading only.)
+      ustring packetIndexPath{};
+
+      //! Number of threads a CompressedVectorReader may use to decode a compressed vector. When greater than 1,
+      //! a read() covering several of the chunks listed in the index packets (see chunkRecordCount) decodes them in
+      //! parallel, each thread writing straight into its own part of the buffers. This needs buffers which aren't
+      //! strings. Otherwise the bytestreams of each data packet are decoded in parallel, which works with any file
+      //! but only helps with several fields. The threads are created when first needed and shared by all readers
+      //! of the ImageFile. 0 or 1 (the default) decodes everything on the calling thread. (Reading only.)
+      unsigned decodeThreadCount = 0;
+
+      //! Runs the parallel decoding tasks instead of the ImageFile's own threads, e.g. to use an application's
+      //! thread pool. Each task it is given must be run exactly once, on any thread; read() waits for them all to
+      //! finish. When decoding chunks, at most decodeThreadCount tasks are given to it per read(). When decoding
+      //! bytestreams, at most decodeThreadCount - 1 tasks are given to it per data packet, the calling thread
+      //! decodes the rest. (Reading only.)
+      std::function<void( std::function<void()> task )> decodeExecutor{};
+
+      //! Have each CompressedVectorWriter write its data packets to the file on a background thread while the next
+      //! packets are being encoded. Write errors are reported by a later CompressedVectorWriter::write() or
+      //! CompressedVectorWriter::close(). This is ignored for writers opened while another writer of the ImageFile
+      //! is open, since they keep their packets in a temporary file until they are closed. (Writing only.)
+      bool backgroundWrite = false;
+
+      //! Number of records in each chunk of a compressed vector. When non-zero, every CompressedVectorWriter writes
+      //! out all of its bytestreams every chunkRecordCount records, so each chunk starts a new data packet with the
+      //! same record in every bytestream & can be decoded without the packets before it. The index packets record
+      //! where each chunk starts. Files are still standard E57, but smaller chunks mean more, smaller packets. It is
+      //! rounded up to a multiple of 64 so bit-packed values end on a word boundary. 0 (the default) lets the
+      //! bytestreams drift across packets. (Writing only.)
+      uint64_t chunkRecordCount = 0;
+
+      //! Number of threads a CompressedVectorWriter may use to encode a compressed vector. When greater than 1, the
+      //! bytestreams of each data packet are encoded in parallel & the packet is put together once they are all
+      //! done, which helps with several fields. The data written is the same either way. The threads are created
+      //! when first needed and shared by all writers of the ImageFile. 0 or 1 (the default) encodes everything on
+      //! the calling thread. (Writing only.)
+      unsigned encodeThreadCount = 0;
+
+      //! Runs the parallel encoding tasks instead of the ImageFile's own threads, e.g. to use an application's
+      //! thread pool. Each task it is given must be run exactly once, on any thread; write() waits for them all to
+      //! finish. At most encodeThreadCount - 1 tasks are given to it per data packet, the calling thread encodes the
+      //! rest. (Writing only.)
+      std::function<void( std::function<void()> task )> encodeExecutor{};
+   };
+
    //! @brief The URI of ASTM E57 v1.0 standard XML namespace
    //! @note Even though this URI does not point to a valid document, the standard (section 8.4.2.3)
    //! says that this is the required namespace.
@@ -364,6 +440,10 @@ protected:
       //! \cond documentNonPublic   The following isn't part of the API, and isn't
       //! documented.
    private:
+      friend class CompressedVectorReaderImpl;
+
+      explicit SourceDestBuffer( std::shared_ptr<SourceDestBufferImpl> ni ); // internal use only
+
       E57_OBJECT_IMPLEMENTATION( SourceDestBuffer ) // Internal implementation details, not part of
                                                     // API, must be last in object
       //! \endcond
@@ -376,7 +456,7 @@ protected:
 
       unsigned read();
       unsigned read( std::vector<SourceDestBuffer> &dbufs );
-      void seek( int64_t recordNumber ); // !!! not implemented yet
+      void seek( int64_t recordNumber );
       void close();
       bool isOpen();
       CompressedVectorNode compressedVectorNode() const;
@@ -670,6 +750,7 @@ protected:
    public:
       ImageFile() = delete;
       ImageFile( const ustring &fname, const ustring &mode, ReadChecksumPolicy checksumPolicy = ChecksumPolicy::All );
+      ImageFile( const ustring &fname, const ustring &mode, const ImageFileOptions &options );
       ImageFile( const char *input, uint64_t size, ReadChecksumPolicy checksumPolicy = ChecksumPolicy::All );
 
       StructureNode root() const;
@@ -44,6 +44,24 @@ namespace e57
    {
       //! Set how frequently to verify the checksums (see ReadChecksumPolicy).
       ReadChecksumPolicy checksumPolicy = ChecksumPolicy::All;
+
+      //! Map the whole file into memory instead of reading it through a file descriptor (see ImageFileOptions).
+      bool memoryMapped = false;
+
+      //! Number of bytes to use for caching data packets (see ImageFileOptions).
+      size_t packetCacheSize = 2 * 1024 * 1024;
+
+      //! Number of data packets to read ahead on a background thread (see ImageFileOptions).
+      unsigned readAheadPacketCount = 0;
+
+      //! Path of a sidecar file to keep packet indexes in (see ImageFileOptions).
+      ustring packetIndexPath{};
+
+      //! Number of threads to decode point data with (see ImageFileOptions).
+      unsigned decodeThreadCount = 0;
+
+      //! Runs the decoding tasks instead of the Reader's own threads (see ImageFileOptions).
+      std::function<void( std::function<void()> task )> decodeExecutor{};
    };
 
    //! @brief Used for reading an E57 file using E57 Simple API.
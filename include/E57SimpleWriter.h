@@ -44,6 +44,18 @@ namespace e57
    {
       ustring guid;               //!< Optional file guid
       ustring coordinateMetadata; //!< Information describing the Coordinate Reference System to be used for the file
+
+      //! Write point data on a background thread while the next points are being encoded (see ImageFileOptions)
+      bool backgroundWrite = false;
+
+      //! Write point data in chunks of this many records which can be decoded independently (see ImageFileOptions)
+      uint64_t chunkRecordCount = 0;
+
+      //! Number of threads to encode point data with (see ImageFileOptions).
+      unsigned encodeThreadCount = 0;
+
+      //! Runs the encoding tasks instead of the Writer's own threads (see ImageFileOptions).
+      std::function<void( std::function<void()> task )> encodeExecutor{};
    };
 
    //! @brief Used for writing an E57 file using the E57 Simple API.
@@ -0,0 +1,551 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "BitPack.h"
+
+// Hardware support we know how to use. Anything else uses the portable version.
+// (NEON has no gather, and only two 64-bit lanes to merge when packing, so ARM uses the portable version.)
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define E57_BITPACK_X86
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define E57_BITPACK_TARGET
+#else
+#define E57_BITPACK_TARGET __attribute__( ( target( "avx2" ) ) )
+#endif
+#endif
+
+namespace
+{
+   using UnpackFunction = void ( * )( const unsigned char *buf, size_t byteCount, size_t firstBit, unsigned bitCount,
+                                      size_t count, int64_t minimum, int64_t *values );
+   using FindOutOfBoundsFunction = size_t ( * )( const int64_t *values, size_t count, int64_t minimum,
+                                                 int64_t maximum );
+   using PackFunction = size_t ( * )( const int64_t *values, size_t count, unsigned bitCount, int64_t minimum,
+                                      uint64_t &pending, unsigned &pendingBitCount, unsigned char *buf );
+   using UnpackScaledFunction = void ( * )( const unsigned char *buf, size_t byteCount, size_t firstBit,
+                                            unsigned bitCount, size_t count, int64_t minimum, double scale,
+                                            double offset, double *values );
+   using UnscaleFunction = size_t ( * )( const double *values, size_t count, double scale, double offset,
+                                         int64_t *rawValues );
+
+   /// The implementations chosen for this CPU
+   struct Implementation
+   {
+      UnpackFunction unpack;
+      FindOutOfBoundsFunction findOutOfBounds;
+      PackFunction pack;
+      UnpackScaledFunction unpackScaled;
+      UnscaleFunction unscale;
+   };
+
+   /// Values this wide or narrower always fit in the 8 bytes starting at their first byte
+   constexpr unsigned cMaxSingleLoadBits = 56;
+
+   /// Number of values unpackScaledBits() unpacks at a time before scaling them
+   constexpr size_t cScaleBlockSize = 64;
+
+   /// Integers with a magnitude below this convert exactly to and from double by adding and subtracting cMagic
+   constexpr int64_t cMaxMagicValue = int64_t{ 1 } << 51;
+   constexpr double cMagic = 6755399441055744.0; // 2^52 + 2^51
+   constexpr int64_t cMagicBits = 0x4338000000000000;
+
+   inline uint64_t load64( const unsigned char *p )
+   {
+      uint64_t value;
+
+      memcpy( &value, p, sizeof( value ) );
+
+      return value;
+   }
+
+   /// Load up to 8 bytes starting at byteOffset, with zeros for any past the end of the buffer
+   inline uint64_t loadPartial64( const unsigned char *buf, size_t byteCount, size_t byteOffset )
+   {
+      uint64_t value = 0;
+
+      memcpy( &value, buf + byteOffset, std::min<size_t>( sizeof( value ), byteCount - byteOffset ) );
+
+      return value;
+   }
+
+   inline uint64_t valueMask( unsigned bitCount )
+   {
+      return ( bitCount == 64 ) ? ~uint64_t{ 0 } : ( uint64_t{ 1 } << bitCount ) - 1;
+   }
+
+   /// Number of values, from the first, which can be read with a 64-bit load starting at their first byte
+   size_t singleLoadCount( size_t byteCount, size_t firstBit, unsigned bitCount, size_t count )
+   {
+      if ( ( bitCount > cMaxSingleLoadBits ) || ( byteCount < 8 ) || ( ( byteCount - 8 ) * 8 + 7 < firstBit ) )
+      {
+         return 0;
+      }
+
+      /// The first byte of value i, ( firstBit + i * bitCount ) / 8, can be at most byteCount - 8
+      return std::min( count, ( ( byteCount - 8 ) * 8 + 7 - firstBit ) / bitCount + 1 );
+   }
+
+   void unpackPortable( const unsigned char *buf, size_t byteCount, size_t firstBit, unsigned bitCount, size_t count,
+                        int64_t minimum, int64_t *values )
+   {
+      const uint64_t mask = valueMask( bitCount );
+      const auto offset = static_cast<uint64_t>( minimum );
+
+      const size_t fastCount = singleLoadCount( byteCount, firstBit, bitCount, count );
+
+      size_t bit = firstBit;
+
+      for ( size_t i = 0; i < fastCount; ++i )
+      {
+         const uint64_t word = load64( buf + bit / 8 ) >> ( bit % 8 );
+
+         values[i] = static_cast<int64_t>( offset + ( word & mask ) );
+
+         bit += bitCount;
+      }
+
+      /// Values near the end of the buffer, or which may be spread over 9 bytes
+      for ( size_t i = fastCount; i < count; ++i )
+      {
+         const size_t byte = bit / 8;
+         const unsigned shift = bit % 8;
+
+         uint64_t word = loadPartial64( buf, byteCount, byte ) >> shift;
+
+         if ( shift + bitCount > 64 )
+         {
+            word |= static_cast<uint64_t>( buf[byte + 8] ) << ( 64 - shift );
+         }
+
+         values[i] = static_cast<int64_t>( offset + ( word & mask ) );
+
+         bit += bitCount;
+      }
+   }
+
+   size_t findOutOfBoundsPortable( const int64_t *values, size_t count, int64_t minimum, int64_t maximum )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         if ( ( values[i] < minimum ) || ( maximum < values[i] ) )
+         {
+            return i;
+         }
+      }
+
+      return count;
+   }
+
+   /// Append the low bitCount bits of value to pending, writing pending out to buf + written if it fills up
+   inline void appendBits( uint64_t value, unsigned bitCount, uint64_t &pending, unsigned &pendingBitCount,
+                           unsigned char *buf, size_t &written )
+   {
+      pending |= value << pendingBitCount;
+      pendingBitCount += bitCount;
+
+      if ( pendingBitCount >= 64 )
+      {
+         memcpy( buf + written, &pending, sizeof( pending ) );
+         written += sizeof( pending );
+
+         /// Keep the bits of value which didn't fit
+         pendingBitCount -= 64;
+         pending = ( pendingBitCount == 0 ) ? 0 : value >> ( bitCount - pendingBitCount );
+      }
+   }
+
+   size_t packPortable( const int64_t *values, size_t count, unsigned bitCount, int64_t minimum, uint64_t &pending,
+                        unsigned &pendingBitCount, unsigned char *buf )
+   {
+      const uint64_t mask = valueMask( bitCount );
+      const auto offset = static_cast<uint64_t>( minimum );
+
+      size_t written = 0;
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         appendBits( ( static_cast<uint64_t>( values[i] ) - offset ) & mask, bitCount, pending, pendingBitCount, buf,
+                     written );
+      }
+
+      return written;
+   }
+
+   void scalePortable( const int64_t *values, size_t count, double scale, double offset, double *scaled )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         scaled[i] = values[i] * scale + offset;
+      }
+   }
+
+   void unpackScaledPortable( const unsigned char *buf, size_t byteCount, size_t firstBit, unsigned bitCount,
+                              size_t count, int64_t minimum, double scale, double offset, double *values )
+   {
+      int64_t block[cScaleBlockSize];
+
+      for ( size_t done = 0; done < count; )
+      {
+         const size_t blockCount = std::min( cScaleBlockSize, count - done );
+
+         unpackPortable( buf, byteCount, firstBit + done * bitCount, bitCount, blockCount, minimum, block );
+         scalePortable( block, blockCount, scale, offset, values + done );
+
+         done += blockCount;
+      }
+   }
+
+   size_t unscalePortable( const double *values, size_t count, double scale, double offset, int64_t *rawValues )
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         const double rawValue = floor( ( values[i] - offset ) / scale + 0.5 );
+
+         if ( ( rawValue < std::numeric_limits<int64_t>::min() ) || ( std::numeric_limits<int64_t>::max() < rawValue ) )
+         {
+            return i;
+         }
+
+         rawValues[i] = static_cast<int64_t>( rawValue );
+      }
+
+      return count;
+   }
+
+#if defined( E57_BITPACK_X86 )
+   /// Unpack 4 values at a time: gather the 64-bit words starting at each value's first byte, then shift each one
+   /// down by its bit offset in that byte.
+   E57_BITPACK_TARGET void unpackAVX2( const unsigned char *buf, size_t byteCount, size_t firstBit, unsigned bitCount,
+                                       size_t count, int64_t minimum, int64_t *values )
+   {
+      const size_t fastCount = singleLoadCount( byteCount, firstBit, bitCount, count );
+
+      const auto base = reinterpret_cast<const long long *>( buf );
+      const __m256i mask = _mm256_set1_epi64x( static_cast<long long>( valueMask( bitCount ) ) );
+      const __m256i offset = _mm256_set1_epi64x( minimum );
+      const __m256i bitInByteMask = _mm256_set1_epi64x( 7 );
+      const __m256i step = _mm256_set1_epi64x( static_cast<long long>( 8 * bitCount ) );
+
+      __m256i bits0 = _mm256_setr_epi64x( static_cast<long long>( firstBit ),
+                                          static_cast<long long>( firstBit + bitCount ),
+                                          static_cast<long long>( firstBit + 2 * bitCount ),
+                                          static_cast<long long>( firstBit + 3 * bitCount ) );
+      __m256i bits1 = _mm256_add_epi64( bits0, _mm256_set1_epi64x( static_cast<long long>( 4 * bitCount ) ) );
+
+      size_t i = 0;
+
+      /// Two independent sets of 4 per iteration so the gathers overlap
+      for ( ; i + 8 <= fastCount; i += 8 )
+      {
+         const __m256i words0 = _mm256_i64gather_epi64( base, _mm256_srli_epi64( bits0, 3 ), 1 );
+         const __m256i words1 = _mm256_i64gather_epi64( base, _mm256_srli_epi64( bits1, 3 ), 1 );
+
+         const __m256i values0 =
+            _mm256_and_si256( _mm256_srlv_epi64( words0, _mm256_and_si256( bits0, bitInByteMask ) ), mask );
+         const __m256i values1 =
+            _mm256_and_si256( _mm256_srlv_epi64( words1, _mm256_and_si256( bits1, bitInByteMask ) ), mask );
+
+         _mm256_storeu_si256( reinterpret_cast<__m256i *>( values + i ), _mm256_add_epi64( values0, offset ) );
+         _mm256_storeu_si256( reinterpret_cast<__m256i *>( values + i + 4 ), _mm256_add_epi64( values1, offset ) );
+
+         bits0 = _mm256_add_epi64( bits0, step );
+         bits1 = _mm256_add_epi64( bits1, step );
+      }
+
+      unpackPortable( buf, byteCount, firstBit + i * bitCount, bitCount, count - i, minimum, values + i );
+   }
+
+   E57_BITPACK_TARGET size_t findOutOfBoundsAVX2( const int64_t *values, size_t count, int64_t minimum,
+                                                  int64_t maximum )
+   {
+      const __m256i low = _mm256_set1_epi64x( minimum );
+      const __m256i high = _mm256_set1_epi64x( maximum );
+
+      size_t i = 0;
+
+      /// Stop at the first set of 4 with a bad value and let the portable version say which one it is
+      for ( ; i + 4 <= count; i += 4 )
+      {
+         const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( values + i ) );
+         const __m256i out = _mm256_or_si256( _mm256_cmpgt_epi64( low, v ), _mm256_cmpgt_epi64( v, high ) );
+
+         if ( !_mm256_testz_si256( out, out ) )
+         {
+            break;
+         }
+      }
+
+      return i + findOutOfBoundsPortable( values + i, count - i, minimum, maximum );
+   }
+
+   /// Combine a = [v0 v1 v2 v3] and b = [v4 v5 v6 v7] into [v0|v1<<shift v2|v3<<shift v4|v5<<shift v6|v7<<shift]
+   E57_BITPACK_TARGET inline __m256i combinePairs( __m256i a, __m256i b, __m128i shift )
+   {
+      const __m256i even = _mm256_unpacklo_epi64( a, b ); // v0 v4 v2 v6
+      const __m256i odd = _mm256_unpackhi_epi64( a, b );  // v1 v5 v3 v7
+
+      const __m256i pairs = _mm256_or_si256( even, _mm256_sll_epi64( odd, shift ) );
+
+      return _mm256_permute4x64_epi64( pairs, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+   }
+
+   /// Subtract the minimum from 32 values at a time, then repeatedly merge neighbouring values into one of twice the
+   /// width for as long as they fit in 64 bits. The serial part - appending to pending - is then done once per 2, 4
+   /// or 8 values instead of once per value.
+   E57_BITPACK_TARGET size_t packAVX2( const int64_t *values, size_t count, unsigned bitCount, int64_t minimum,
+                                       uint64_t &pending, unsigned &pendingBitCount, unsigned char *buf )
+   {
+      constexpr size_t cBlockSize = 32;
+      constexpr unsigned cBlockRegisters = cBlockSize / 4;
+
+      /// Nothing can be merged
+      if ( bitCount > 32 )
+      {
+         return packPortable( values, count, bitCount, minimum, pending, pendingBitCount, buf );
+      }
+
+      const __m256i mask = _mm256_set1_epi64x( static_cast<long long>( valueMask( bitCount ) ) );
+      const __m256i offset = _mm256_set1_epi64x( minimum );
+
+      /// Work out how many times the values can be merged
+      unsigned mergedRegisters = cBlockRegisters;
+      unsigned mergedBitCount = bitCount;
+
+      while ( ( mergedRegisters > 1 ) && ( 2 * mergedBitCount <= 64 ) )
+      {
+         mergedRegisters /= 2;
+         mergedBitCount *= 2;
+      }
+
+      size_t written = 0;
+      size_t i = 0;
+
+      for ( ; i + cBlockSize <= count; i += cBlockSize )
+      {
+         __m256i words[cBlockRegisters];
+
+         for ( unsigned r = 0; r < cBlockRegisters; ++r )
+         {
+            const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( values + i + 4 * r ) );
+
+            words[r] = _mm256_and_si256( _mm256_sub_epi64( v, offset ), mask );
+         }
+
+         for ( unsigned registers = cBlockRegisters, shift = bitCount; registers > mergedRegisters;
+               registers /= 2, shift *= 2 )
+         {
+            const __m128i shiftCount = _mm_cvtsi32_si128( static_cast<int>( shift ) );
+
+            for ( unsigned r = 0; r < registers / 2; ++r )
+            {
+               words[r] = combinePairs( words[2 * r], words[2 * r + 1], shiftCount );
+            }
+         }
+
+         alignas( 32 ) uint64_t merged[cBlockSize];
+
+         for ( unsigned r = 0; r < mergedRegisters; ++r )
+         {
+            _mm256_store_si256( reinterpret_cast<__m256i *>( merged + 4 * r ), words[r] );
+         }
+
+         for ( unsigned k = 0; k < 4 * mergedRegisters; ++k )
+         {
+            appendBits( merged[k], mergedBitCount, pending, pendingBitCount, buf, written );
+         }
+      }
+
+      return written +
+             packPortable( values + i, count - i, bitCount, minimum, pending, pendingBitCount, buf + written );
+   }
+
+   /// Convert 4 values at a time to double using cMagic. They must all be smaller in magnitude than cMaxMagicValue.
+   E57_BITPACK_TARGET void scaleAVX2( const int64_t *values, size_t count, double scale, double offset,
+                                      double *scaled )
+   {
+      const __m256i magicBits = _mm256_set1_epi64x( cMagicBits );
+      const __m256d magic = _mm256_set1_pd( cMagic );
+      const __m256d scaleV = _mm256_set1_pd( scale );
+      const __m256d offsetV = _mm256_set1_pd( offset );
+
+      size_t i = 0;
+
+      for ( ; i + 4 <= count; i += 4 )
+      {
+         const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( values + i ) );
+         const __m256d d = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_add_epi64( v, magicBits ) ), magic );
+
+         /// Separate multiply and add (not fused) to round the same way as the portable version
+         _mm256_storeu_pd( scaled + i, _mm256_add_pd( _mm256_mul_pd( d, scaleV ), offsetV ) );
+      }
+
+      scalePortable( values + i, count - i, scale, offset, scaled + i );
+   }
+
+   E57_BITPACK_TARGET void unpackScaledAVX2( const unsigned char *buf, size_t byteCount, size_t firstBit,
+                                             unsigned bitCount, size_t count, int64_t minimum, double scale,
+                                             double offset, double *values )
+   {
+      /// All values are between minimum and minimum + the mask
+      if ( ( bitCount >= 51 ) || ( minimum <= -cMaxMagicValue ) ||
+           ( minimum >= cMaxMagicValue - static_cast<int64_t>( valueMask( bitCount ) ) ) )
+      {
+         unpackScaledPortable( buf, byteCount, firstBit, bitCount, count, minimum, scale, offset, values );
+         return;
+      }
+
+      int64_t block[cScaleBlockSize];
+
+      for ( size_t done = 0; done < count; )
+      {
+         const size_t blockCount = std::min( cScaleBlockSize, count - done );
+
+         unpackAVX2( buf, byteCount, firstBit + done * bitCount, bitCount, blockCount, minimum, block );
+         scaleAVX2( block, blockCount, scale, offset, values + done );
+
+         done += blockCount;
+      }
+   }
+
+   /// Scale and round 4 values at a time, and convert them to integers using cMagic. Sets of 4 containing a value
+   /// too big for that (or NaN) go through the portable version.
+   E57_BITPACK_TARGET size_t unscaleAVX2( const double *values, size_t count, double scale, double offset,
+                                          int64_t *rawValues )
+   {
+      const __m256i magicBits = _mm256_set1_epi64x( cMagicBits );
+      const __m256d magic = _mm256_set1_pd( cMagic );
+      const __m256d limit = _mm256_set1_pd( static_cast<double>( cMaxMagicValue ) );
+      const __m256d signBit = _mm256_set1_pd( -0.0 );
+      const __m256d half = _mm256_set1_pd( 0.5 );
+      const __m256d scaleV = _mm256_set1_pd( scale );
+      const __m256d offsetV = _mm256_set1_pd( offset );
+
+      size_t i = 0;
+
+      for ( ; i + 4 <= count; i += 4 )
+      {
+         const __m256d v = _mm256_loadu_pd( values + i );
+         const __m256d rounded =
+            _mm256_floor_pd( _mm256_add_pd( _mm256_div_pd( _mm256_sub_pd( v, offsetV ), scaleV ), half ) );
+         const __m256d inRange = _mm256_cmp_pd( _mm256_andnot_pd( signBit, rounded ), limit, _CMP_LT_OQ );
+
+         if ( _mm256_movemask_pd( inRange ) == 0xF )
+         {
+            const __m256i raw = _mm256_sub_epi64( _mm256_castpd_si256( _mm256_add_pd( rounded, magic ) ), magicBits );
+
+            _mm256_storeu_si256( reinterpret_cast<__m256i *>( rawValues + i ), raw );
+         }
+         else
+         {
+            const size_t bad = unscalePortable( values + i, 4, scale, offset, rawValues + i );
+
+            if ( bad < 4 )
+            {
+               return i + bad;
+            }
+         }
+      }
+
+      return i + unscalePortable( values + i, count - i, scale, offset, rawValues + i );
+   }
+
+   bool hasHardwareSupport()
+   {
+#if defined( _MSC_VER )
+      int info[4];
+
+      __cpuid( info, 0 );
+      if ( info[0] < 7 )
+      {
+         return false;
+      }
+
+      /// The OS must save the AVX registers (OSXSAVE, AVX & XCR0 bits 1-2) as well as the CPU supporting AVX2
+      __cpuid( info, 1 );
+      if ( ( ( info[2] & ( 1 << 27 ) ) == 0 ) || ( ( info[2] & ( 1 << 28 ) ) == 0 ) || ( ( _xgetbv( 0 ) & 6 ) != 6 ) )
+      {
+         return false;
+      }
+
+      __cpuidex( info, 7, 0 );
+
+      return ( info[1] & ( 1 << 5 ) ) != 0;
+#else
+      return __builtin_cpu_supports( "avx2" );
+#endif
+   }
+#endif
+
+   const Implementation &selectImplementation()
+   {
+#if defined( E57_BITPACK_X86 )
+      static const Implementation cAVX2 = { unpackAVX2, findOutOfBoundsAVX2, packAVX2, unpackScaledAVX2,
+                                                unscaleAVX2 };
+
+      if ( hasHardwareSupport() )
+      {
+#ifdef E57_MAX_VERBOSE
+         std::cout << "BitPack: using AVX2 implementation" << std::endl;
+#endif
+         return cAVX2;
+      }
+#endif
+
+      static const Implementation cPortable = { unpackPortable, findOutOfBoundsPortable, packPortable,
+                                                    unpackScaledPortable, unscalePortable };
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "BitPack: using portable implementation" << std::endl;
+#endif
+      return cPortable;
+   }
+
+   const Implementation &implementation()
+   {
+      static const Implementation &sImplementation = selectImplementation();
+
+      return sImplementation;
+   }
+}
+
+namespace e57
+{
+   void unpackBits( const char *buf, size_t byteCount, size_t firstBit, unsigned bitCount, size_t count,
+                    int64_t minimum, int64_t *values )
+   {
+      implementation().unpack( reinterpret_cast<const unsigned char *>( buf ), byteCount, firstBit, bitCount, count,
+                               minimum, values );
+   }
+
+   size_t findOutOfBounds( const int64_t *values, size_t count, int64_t minimum, int64_t maximum )
+   {
+      return implementation().findOutOfBounds( values, count, minimum, maximum );
+   }
+
+   size_t packBits( const int64_t *values, size_t count, unsigned bitCount, int64_t minimum, uint64_t &pending,
+                    unsigned &pendingBitCount, char *buf )
+   {
+      return implementation().pack( values, count, bitCount, minimum, pending, pendingBitCount,
+                                    reinterpret_cast<unsigned char *>( buf ) );
+   }
+
+   void unpackScaledBits( const char *buf, size_t byteCount, size_t firstBit, unsigned bitCount, size_t count,
+                          int64_t minimum, double scale, double offset, double *values )
+   {
+      implementation().unpackScaled( reinterpret_cast<const unsigned char *>( buf ), byteCount, firstBit, bitCount,
+                                     count, minimum, scale, offset, values );
+   }
+
+   size_t unscaleValues( const double *values, size_t count, double scale, double offset, int64_t *rawValues )
+   {
+      return implementation().unscale( values, count, scale, offset, rawValues );
+   }
+}
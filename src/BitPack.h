@@ -0,0 +1,49 @@
+#pragma once
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace e57
+{
+   /// Unpack values from an E57 bitpacked bytestream.
+   ///
+   /// Reads count values of bitCount bits each (1 to 64), packed least significant bit first starting firstBit bits
+   /// into buf, adds minimum to each and stores them in values. Only the first byteCount bytes of buf are read, and
+   /// they must hold all of the values' bits. buf doesn't need any particular alignment.
+   ///
+   /// The implementation is chosen once at runtime based on the CPU: AVX2 on x86-64, or a portable version using
+   /// unaligned 64-bit loads. All produce identical results.
+   void unpackBits( const char *buf, size_t byteCount, size_t firstBit, unsigned bitCount, size_t count,
+                    int64_t minimum, int64_t *values );
+
+   /// Find the first of count values which is outside [minimum, maximum].
+   ///
+   /// Returns its index, or count if all of the values are in bounds.
+   size_t findOutOfBounds( const int64_t *values, size_t count, int64_t minimum, int64_t maximum );
+
+   /// Pack values into an E57 bitpacked bytestream.
+   ///
+   /// Subtracts minimum from each of count values and appends the low bitCount bits (1 to 64) of each result, least
+   /// significant bit first, to the pendingBitCount (0 to 63) bits held in pending. Whenever pending fills up it is
+   /// written to buf as 8 little-endian bytes. On return pending holds the leftover bits (which are zero above
+   /// pendingBitCount), and the number of bytes written is returned. buf doesn't need any particular alignment.
+   ///
+   /// The values must already be in bounds (see findOutOfBounds()). The implementation is chosen the same way as for
+   /// unpackBits().
+   size_t packBits( const int64_t *values, size_t count, unsigned bitCount, int64_t minimum, uint64_t &pending,
+                    unsigned &pendingBitCount, char *buf );
+
+   /// Unpack values as unpackBits() does, and store ( value * scale ) + offset for each one.
+   ///
+   /// The results are identical to doing that one value at a time in double precision.
+   void unpackScaledBits( const char *buf, size_t byteCount, size_t firstBit, unsigned bitCount, size_t count,
+                          int64_t minimum, double scale, double offset, double *values );
+
+   /// Undo scale and offset: store floor( ( value - offset ) / scale + 0.5 ) for each of count values in rawValues.
+   ///
+   /// Returns the index of the first value whose result doesn't fit in an int64_t (with the ones before it stored),
+   /// or count if they all do.
+   size_t unscaleValues( const double *values, size_t count, double scale, double offset, int64_t *rawValues );
+}
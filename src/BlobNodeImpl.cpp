@@ -62,8 +62,7 @@ namespace e57
 #endif
 
       /// Write header at beginning of section
-      imf->file_->seek( binarySectionLogicalStart_ );
-      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
+      imf->file_->writeAt( binarySectionLogicalStart_, reinterpret_cast<char *>( &header ), sizeof( header ) );
    }
 
    BlobNodeImpl::BlobNodeImpl( ImageFileImplWeakPtr destImageFile, int64_t fileOffset, int64_t length ) :
@@ -133,9 +132,9 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->read( reinterpret_cast<char *>( buf ),
-                        static_cast<size_t>( count ) ); //??? arg1 void* ?
+      /// Don't move the file position, CompressedVectorReaders may be reading on other threads
+      imf->file_->readAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                          reinterpret_cast<char *>( buf ), static_cast<size_t>( count ) );
    }
 
    void BlobNodeImpl::write( uint8_t *buf, int64_t start, size_t count )
@@ -162,9 +161,8 @@ namespace e57
       }
 
       ImageFileImplSharedPtr imf( destImageFile_ );
-      imf->file_->seek( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start );
-      imf->file_->write( reinterpret_cast<char *>( buf ),
-                         static_cast<size_t>( count ) ); //??? arg1 void* ?
+      imf->file_->writeAt( binarySectionLogicalStart_ + sizeof( BlobSectionHeader ) + start,
+                           reinterpret_cast<char *>( buf ), static_cast<size_t>( count ) );
    }
 
    void BlobNodeImpl::checkLeavesInSet( const StringSet &pathNames, NodeImplSharedPtr origin )
@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <cstring>
+#include <iostream>
+
+#include "CRC32C.h"
+
+// Hardware support we know how to use. Anything else uses the portable slicing-by-8 version.
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define E57_CRC32C_X86
+#include <nmmintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define E57_CRC32C_TARGET
+#else
+#define E57_CRC32C_TARGET __attribute__( ( target( "sse4.2" ) ) )
+#endif
+#elif defined( __aarch64__ ) && !defined( __AARCH64EB__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define E57_CRC32C_ARM
+#include <arm_acle.h>
+#if defined( __clang__ )
+#define E57_CRC32C_TARGET __attribute__( ( target( "crc" ) ) )
+#else
+#define E57_CRC32C_TARGET __attribute__( ( target( "+crc" ) ) )
+#endif
+#if defined( __linux__ )
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 ( 1 << 7 )
+#endif
+#endif
+#endif
+
+namespace
+{
+   /// CRC-32C polynomial 0x1EDC6F41, bit-reversed
+   constexpr uint32_t cPolynomial = 0x82F63B78;
+
+   using CRCFunction = uint32_t ( * )( uint32_t crc, const unsigned char *buf, size_t size );
+
+   /// Tables for the portable slicing-by-8 implementation.
+   /// table[0] is the usual byte-at-a-time table, table[k] advances a byte through k more zero bytes.
+   struct SliceTables
+   {
+      uint32_t table[8][256];
+
+      SliceTables()
+      {
+         for ( uint32_t n = 0; n < 256; ++n )
+         {
+            uint32_t crc = n;
+
+            for ( int k = 0; k < 8; ++k )
+            {
+               crc = ( crc & 1 ) ? ( ( crc >> 1 ) ^ cPolynomial ) : ( crc >> 1 );
+            }
+
+            table[0][n] = crc;
+         }
+
+         for ( uint32_t n = 0; n < 256; ++n )
+         {
+            for ( int k = 1; k < 8; ++k )
+            {
+               const uint32_t prev = table[k - 1][n];
+
+               table[k][n] = ( prev >> 8 ) ^ table[0][prev & 0xFF];
+            }
+         }
+      }
+   };
+
+   const SliceTables &sliceTables()
+   {
+      static const SliceTables sTables;
+
+      return sTables;
+   }
+
+   inline uint32_t load32LE( const unsigned char *p )
+   {
+      return static_cast<uint32_t>( p[0] ) | ( static_cast<uint32_t>( p[1] ) << 8 ) |
+             ( static_cast<uint32_t>( p[2] ) << 16 ) | ( static_cast<uint32_t>( p[3] ) << 24 );
+   }
+
+   uint32_t crc32cSliceBy8( uint32_t crc, const unsigned char *buf, size_t size )
+   {
+      const auto &table = sliceTables().table;
+
+      while ( size >= 8 )
+      {
+         const uint32_t low = crc ^ load32LE( buf );
+         const uint32_t high = load32LE( buf + 4 );
+
+         crc = table[7][low & 0xFF] ^ table[6][( low >> 8 ) & 0xFF] ^ table[5][( low >> 16 ) & 0xFF] ^
+               table[4][low >> 24] ^ table[3][high & 0xFF] ^ table[2][( high >> 8 ) & 0xFF] ^
+               table[1][( high >> 16 ) & 0xFF] ^ table[0][high >> 24];
+
+         buf += 8;
+         size -= 8;
+      }
+
+      while ( size > 0 )
+      {
+         crc = table[0][( crc ^ *buf ) & 0xFF] ^ ( crc >> 8 );
+
+         ++buf;
+         --size;
+      }
+
+      return crc;
+   }
+
+#if defined( E57_CRC32C_X86 ) || defined( E57_CRC32C_ARM )
+   /// The hardware versions run three independent CRCs over adjacent lanes of this many bytes to hide the latency
+   /// of the crc instruction, then stitch them together. 3 * 336 = 1008 covers most of a 1020 byte logical page.
+   constexpr size_t cLaneSize = 336;
+
+   /// Apply a 32x32 GF(2) matrix to a vector
+   uint32_t gf2MatrixTimes( const uint32_t *matrix, uint32_t vec )
+   {
+      uint32_t sum = 0;
+
+      while ( vec != 0 )
+      {
+         if ( vec & 1 )
+         {
+            sum ^= *matrix;
+         }
+
+         vec >>= 1;
+         ++matrix;
+      }
+
+      return sum;
+   }
+
+   /// result = a * b (result must not alias a or b)
+   void gf2MatrixMultiply( uint32_t *result, const uint32_t *a, const uint32_t *b )
+   {
+      for ( int n = 0; n < 32; ++n )
+      {
+         result[n] = gf2MatrixTimes( a, b[n] );
+      }
+   }
+
+   /// Tables to advance a CRC over cLaneSize zero bytes, used to combine the lanes.
+   struct LaneShiftTables
+   {
+      uint32_t table[4][256];
+
+      LaneShiftTables()
+      {
+         // Operator for one zero bit
+         uint32_t power[32];
+
+         power[0] = cPolynomial;
+
+         for ( int n = 1; n < 32; ++n )
+         {
+            power[n] = 1U << ( n - 1 );
+         }
+
+         // Square it up to one zero byte
+         uint32_t temp[32];
+
+         for ( int i = 0; i < 3; ++i )
+         {
+            gf2MatrixMultiply( temp, power, power );
+            std::memcpy( power, temp, sizeof( power ) );
+         }
+
+         // Raise to cLaneSize zero bytes
+         uint32_t op[32];
+
+         for ( int n = 0; n < 32; ++n )
+         {
+            op[n] = 1U << n;
+         }
+
+         for ( size_t count = cLaneSize; count != 0; count >>= 1 )
+         {
+            if ( count & 1 )
+            {
+               gf2MatrixMultiply( temp, power, op );
+               std::memcpy( op, temp, sizeof( op ) );
+            }
+
+            gf2MatrixMultiply( temp, power, power );
+            std::memcpy( power, temp, sizeof( power ) );
+         }
+
+         for ( uint32_t n = 0; n < 256; ++n )
+         {
+            table[0][n] = gf2MatrixTimes( op, n );
+            table[1][n] = gf2MatrixTimes( op, n << 8 );
+            table[2][n] = gf2MatrixTimes( op, n << 16 );
+            table[3][n] = gf2MatrixTimes( op, n << 24 );
+         }
+      }
+
+      uint32_t shift( uint32_t crc ) const
+      {
+         return table[0][crc & 0xFF] ^ table[1][( crc >> 8 ) & 0xFF] ^ table[2][( crc >> 16 ) & 0xFF] ^
+                table[3][crc >> 24];
+      }
+   };
+
+   const LaneShiftTables &laneShiftTables()
+   {
+      static const LaneShiftTables sTables;
+
+      return sTables;
+   }
+
+   inline uint64_t load64( const unsigned char *p )
+   {
+      uint64_t value;
+      std::memcpy( &value, p, sizeof( value ) );
+      return value;
+   }
+#endif
+
+#if defined( E57_CRC32C_X86 )
+   E57_CRC32C_TARGET uint32_t crc32cHardware( uint32_t crc, const unsigned char *buf, size_t size )
+   {
+      const LaneShiftTables &lanes = laneShiftTables();
+
+      while ( size >= 3 * cLaneSize )
+      {
+         uint64_t crc0 = crc;
+         uint64_t crc1 = 0;
+         uint64_t crc2 = 0;
+
+         const unsigned char *end = buf + cLaneSize;
+
+         do
+         {
+            crc0 = _mm_crc32_u64( crc0, load64( buf ) );
+            crc1 = _mm_crc32_u64( crc1, load64( buf + cLaneSize ) );
+            crc2 = _mm_crc32_u64( crc2, load64( buf + 2 * cLaneSize ) );
+
+            buf += 8;
+         } while ( buf < end );
+
+         crc = lanes.shift( static_cast<uint32_t>( crc0 ) ) ^ static_cast<uint32_t>( crc1 );
+         crc = lanes.shift( crc ) ^ static_cast<uint32_t>( crc2 );
+
+         buf += 2 * cLaneSize;
+         size -= 3 * cLaneSize;
+      }
+
+      uint64_t crc64 = crc;
+
+      while ( size >= 8 )
+      {
+         crc64 = _mm_crc32_u64( crc64, load64( buf ) );
+
+         buf += 8;
+         size -= 8;
+      }
+
+      crc = static_cast<uint32_t>( crc64 );
+
+      while ( size > 0 )
+      {
+         crc = _mm_crc32_u8( crc, *buf );
+
+         ++buf;
+         --size;
+      }
+
+      return crc;
+   }
+
+   bool hasHardwareSupport()
+   {
+#if defined( _MSC_VER )
+      int info[4];
+      __cpuid( info, 1 );
+
+      return ( info[2] & ( 1 << 20 ) ) != 0;
+#else
+      return __builtin_cpu_supports( "sse4.2" );
+#endif
+   }
+#elif defined( E57_CRC32C_ARM )
+   E57_CRC32C_TARGET uint32_t crc32cHardware( uint32_t crc, const unsigned char *buf, size_t size )
+   {
+      const LaneShiftTables &lanes = laneShiftTables();
+
+      while ( size >= 3 * cLaneSize )
+      {
+         uint32_t crc0 = crc;
+         uint32_t crc1 = 0;
+         uint32_t crc2 = 0;
+
+         const unsigned char *end = buf + cLaneSize;
+
+         do
+         {
+            crc0 = __crc32cd( crc0, load64( buf ) );
+            crc1 = __crc32cd( crc1, load64( buf + cLaneSize ) );
+            crc2 = __crc32cd( crc2, load64( buf + 2 * cLaneSize ) );
+
+            buf += 8;
+         } while ( buf < end );
+
+         crc = lanes.shift( crc0 ) ^ crc1;
+         crc = lanes.shift( crc ) ^ crc2;
+
+         buf += 2 * cLaneSize;
+         size -= 3 * cLaneSize;
+      }
+
+      while ( size >= 8 )
+      {
+         crc = __crc32cd( crc, load64( buf ) );
+
+         buf += 8;
+         size -= 8;
+      }
+
+      while ( size > 0 )
+      {
+         crc = __crc32cb( crc, *buf );
+
+         ++buf;
+         --size;
+      }
+
+      return crc;
+   }
+
+   bool hasHardwareSupport()
+   {
+#if defined( __ARM_FEATURE_CRC32 ) || defined( __APPLE__ )
+      return true;
+#elif defined( __linux__ )
+      return ( getauxval( AT_HWCAP ) & HWCAP_CRC32 ) != 0;
+#else
+      return false;
+#endif
+   }
+#endif
+
+   CRCFunction selectImplementation()
+   {
+#if defined( E57_CRC32C_X86 ) || defined( E57_CRC32C_ARM )
+      if ( hasHardwareSupport() )
+      {
+#ifdef E57_MAX_VERBOSE
+         std::cout << "crc32c: using hardware implementation" << std::endl;
+#endif
+         return crc32cHardware;
+      }
+#endif
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "crc32c: using portable implementation" << std::endl;
+#endif
+      return crc32cSliceBy8;
+   }
+}
+
+namespace e57
+{
+   uint32_t crc32c( const char *buf, size_t size )
+   {
+      static const CRCFunction sCRCFunction = selectImplementation();
+
+      return ~sCRCFunction( 0xFFFFFFFF, reinterpret_cast<const unsigned char *>( buf ), size );
+   }
+
+   uint32_t crc32cPortable( const char *buf, size_t size )
+   {
+      return ~crc32cSliceBy8( 0xFFFFFFFF, reinterpret_cast<const unsigned char *>( buf ), size );
+   }
+}
@@ -0,0 +1,21 @@
+#pragma once
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace e57
+{
+   /// Calculate the CRC-32C (Castagnoli) of a buffer.
+   ///
+   /// This is the standard CRC-32C (polynomial 0x1EDC6F41, reflected, initial value & final XOR of 0xFFFFFFFF).
+   /// The implementation is chosen once at runtime based on the CPU: SSE4.2 on x86-64, the CRC extension on
+   /// ARMv8, or a portable slicing-by-8 version. All produce identical results.
+   uint32_t crc32c( const char *buf, size_t size );
+
+   /// Calculate the CRC-32C of a buffer using the portable slicing-by-8 version, whatever the CPU.
+   ///
+   /// This is what crc32c() falls back to. It is exposed so it can be tested on CPUs with hardware support.
+   uint32_t crc32cPortable( const char *buf, size_t size );
+}
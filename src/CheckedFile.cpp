@@ -34,25 +34,35 @@
 #if defined( _MSC_VER )
 #include <codecvt>
 #include <io.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #elif defined( __GNUC__ )
 #define _LARGEFILE64_SOURCE
 #define __LARGE64_FILES
+#include <io.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #else
 #error "no supported compiler defined"
 #endif
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #elif defined( __linux__ )
 #define _LARGEFILE64_SOURCE
 #define __LARGE64_FILES
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #elif defined( __APPLE__ )
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #elif defined( __BSD )
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -64,9 +74,9 @@
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
+#include <limits>
 
-#include "CRC.h"
-
+#include "CRC32C.h"
 #include "CheckedFile.h"
 #include "StringFunctions.h"
 
@@ -83,6 +93,12 @@ constexpr size_t CheckedFile::physicalPageSizeLog2;
 constexpr size_t CheckedFile::physicalPageSize;
 constexpr uint64_t CheckedFile::physicalPageSizeMask;
 constexpr size_t CheckedFile::logicalPageSize;
+constexpr size_t CheckedFile::readBatchPageCount;
+constexpr size_t CheckedFile::writeBufferMaxPageCount;
+
+/// Number of reads against the current access pattern before we change the advice given to the OS
+/// about a mapped file
+constexpr int cMapAdviceThreshold = 4;
 
 /// Tool class to read buffer efficiently without
 /// multiplying copy operations.
@@ -126,14 +142,21 @@ public:
       return true;
    }
 
+   uint64_t size() const
+   {
+      return streamSize_;
+   }
+
+   /// Direct access to the whole buffer so pages can be used in place
+   const char *data() const
+   {
+      return stream_;
+   }
+
    void read( char *buffer, uint64_t count )
    {
-      const uint64_t start = cursorStream_;
-      for ( uint64_t i = 0; i < count; ++i )
-      {
-         buffer[i] = stream_[start + i];
-         ++cursorStream_;
-      }
+      memcpy( buffer, stream_ + cursorStream_, static_cast<size_t>( count ) );
+      cursorStream_ += count;
    }
 
 private:
@@ -166,6 +189,28 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
       }
       break;
 
+      case ReadOnlyMapped:
+      {
+#if defined( _MSC_VER )
+         constexpr int readFlags = O_RDONLY | O_BINARY;
+#else
+         constexpr int readFlags = O_RDONLY;
+#endif
+
+         fd_ = open64( fileName_, readFlags, 0 );
+
+         readOnly_ = true;
+
+         physicalLength_ = lseek64( 0LL, SEEK_END );
+         lseek64( 0, SEEK_SET );
+
+         logicalLength_ = physicalToLogical( physicalLength_ );
+
+         /// If this fails we just carry on reading through fd_
+         mapFile();
+      }
+      break;
+
       case WriteCreate:
       {
          /// File truncated to zero length if already exists
@@ -192,7 +237,10 @@ CheckedFile::CheckedFile( const ustring &fileName, Mode mode, ReadChecksumPolicy
 
          fd_ = open64( fileName_, writeFlags, 0 );
 
-         logicalLength_ = physicalToLogical( length( Physical ) ); //???
+         physicalLength_ = lseek64( 0LL, SEEK_END );
+         lseek64( 0, SEEK_SET );
+
+         logicalLength_ = physicalToLogical( physicalLength_ ); //???
       }
       break;
    }
@@ -257,10 +305,15 @@ CheckedFile::~CheckedFile()
 
 void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
    //??? what if read past logical end?, or physical end?
    //??? need to keep track of logical length?
    //??? check bufSize OK
 
+   /// Make sure anything we have written is in the file before reading it back
+   flushWriteBuffer();
+
    const uint64_t end = position( Logical ) + nRead;
    const uint64_t logicalLength = length( Logical );
 
@@ -277,49 +330,50 @@ void CheckedFile::read( char *buf, size_t nRead, size_t /*bufSize*/ )
 
    size_t n = std::min( nRead, logicalPageSize - pageOffset );
 
-   /// Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = &page_buffer_v[0];
-
-   auto checksumMod = static_cast<const unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
-
    while ( nRead > 0 )
    {
-      readPhysicalPage( page_buffer, page );
+      const size_t pagesLeft = ( pageOffset + nRead + logicalPageSize - 1 ) / logicalPageSize;
 
-      switch ( checkSumPolicy_ )
-      {
-         case ChecksumPolicy::None:
-            break;
+      /// Buffers & mapped files are used in place, otherwise read as many of the remaining pages as fit in the
+      /// staging buffer with one call
+      const size_t pageCount = ( bufView_ != nullptr ) ? pagesLeft : std::min( pagesLeft, readBatchPageCount );
 
-         case ChecksumPolicy::All:
-            verifyChecksum( page_buffer, page );
-            break;
+      const char *page_buffer = fetchPages( page, pageCount );
 
-         default:
-            if ( !( page % checksumMod ) || ( nRead < physicalPageSize ) )
-            {
-               verifyChecksum( page_buffer, page );
-            }
-            break;
-      }
+      for ( size_t i = 0; i < pageCount; ++i )
+      {
+         memcpy( buf, page_buffer + pageOffset, n );
 
-      memcpy( buf, page_buffer + pageOffset, n );
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+         page_buffer += physicalPageSize;
+         ++page;
 
-      buf += n;
-      nRead -= n;
-      pageOffset = 0;
-      ++page;
-
-      n = std::min( nRead, logicalPageSize );
+         n = std::min( nRead, logicalPageSize );
+      }
    }
 
    /// When done, leave cursor just past end of last byte read
    seek( end, Logical );
 }
 
+void CheckedFile::readAt( uint64_t logicalOffset, char *buf, size_t nRead )
+{
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
+   const uint64_t savedPosition = position( Physical );
+
+   seek( logicalOffset, Logical );
+   read( buf, nRead );
+
+   seek( savedPosition, Physical );
+}
+
 void CheckedFile::write( const char *buf, size_t nWrite )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
 #ifdef E57_MAX_VERBOSE
    // cout << "write nWrite=" << nWrite << " position()="<< position() << std::endl;
    // //???
@@ -338,31 +392,17 @@ void CheckedFile::write( const char *buf, size_t nWrite )
 
    size_t n = std::min( nWrite, logicalPageSize - pageOffset );
 
-   /// Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = &page_buffer_v[0];
-
    while ( nWrite > 0 )
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page * physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
+      char *page_buffer = writeBufferPage( page );
 
 #ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] read: '" << page_buffer[0] << "'" << std::endl;
       // cout << "copy " << n << "bytes to page=" << page << " pageOffset=" <<
       // pageOffset << " buf='"; //??? for (size_t i=0; i < n; i++) cout <<
       // buf[i]; cout << "'" << std::endl;
 #endif
       memcpy( page_buffer + pageOffset, buf, n );
-      writePhysicalPage( page_buffer, page );
-#ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] after write: '" << page_buffer[0] << "'" <<
-      // std::endl; //???
-#endif
+
       buf += n;
       nWrite -= n;
       pageOffset = 0;
@@ -379,6 +419,19 @@ void CheckedFile::write( const char *buf, size_t nWrite )
    seek( end, Logical );
 }
 
+/// Write at the given logical offset, leaving the current position alone
+void CheckedFile::writeAt( uint64_t logicalOffset, const char *buf, size_t nWrite )
+{
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
+   const uint64_t savedPosition = position( Physical );
+
+   seek( logicalOffset, Logical );
+   write( buf, nWrite );
+
+   seek( savedPosition, Physical );
+}
+
 CheckedFile &CheckedFile::operator<<( const ustring &s )
 {
    write( s.c_str(), s.length() ); //??? should be times size of uchar?
@@ -424,6 +477,8 @@ template <class FTYPE> CheckedFile &CheckedFile::writeFloatingPoint( FTYPE value
 
 void CheckedFile::seek( uint64_t offset, OffsetMode omode )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
    //??? check for seek beyond logicalLength_
    const auto pos = static_cast<int64_t>( omode == Physical ? offset : logicalToPhysical( offset ) );
 
@@ -484,6 +539,8 @@ uint64_t CheckedFile::lseek64( int64_t offset, int whence )
 
 uint64_t CheckedFile::position( OffsetMode omode )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
    /// Get current file cursor position
    const uint64_t pos = lseek64( 0LL, SEEK_CUR );
 
@@ -497,30 +554,56 @@ uint64_t CheckedFile::position( OffsetMode omode )
 
 uint64_t CheckedFile::length( OffsetMode omode )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
    if ( omode == Physical )
    {
-      if ( readOnly_ )
+      if ( readOnly_ || ( writeBufferPageCount_ == 0 ) )
       {
          return physicalLength_;
       }
 
-      // Current file position
-      uint64_t original_pos = lseek64( 0LL, SEEK_CUR );
+      /// Include pages which have not been flushed yet
+      return std::max( physicalLength_, ( writeBufferFirstPage_ + writeBufferPageCount_ ) * physicalPageSize );
+   }
 
-      // End file position
-      uint64_t end_pos = lseek64( 0LL, SEEK_END );
+   return logicalLength_;
+}
 
-      // Restore original position
-      lseek64( original_pos, SEEK_SET );
+int64_t CheckedFile::modificationTime()
+{
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
 
-      return end_pos;
+   if ( mapBase_ != nullptr )
+   {
+      return mapModificationTime_;
    }
 
-   return logicalLength_;
+   if ( bufView_ != nullptr )
+   {
+      return 0;
+   }
+
+#if defined( _WIN32 )
+   struct _stat64 fileStat;
+
+   if ( _fstat64( fd_, &fileStat ) != 0 )
+#else
+   struct stat fileStat;
+
+   if ( fstat( fd_, &fileStat ) != 0 )
+#endif
+   {
+      return 0;
+   }
+
+   return static_cast<int64_t>( fileStat.st_mtime );
 }
 
 void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
 #ifdef E57_MAX_VERBOSE
    // cout << "extend newLength=" << newLength << " omode="<< omode << std::endl;
    // //???
@@ -574,18 +657,9 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
       n = logicalPageSize - pageOffset;
    }
 
-   /// Allocate temp page buffer
-   std::vector<char> page_buffer_v( physicalPageSize );
-   char *page_buffer = &page_buffer_v[0];
-
    while ( nWrite > 0 )
    {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page * physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
+      char *page_buffer = writeBufferPage( page );
 
 #ifdef E57_MAX_VERBOSE
       // cout << "extend " << n << "bytes on page=" << page << " pageOffset=" <<
@@ -593,7 +667,6 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
       // //???
 #endif
       memset( page_buffer + pageOffset, 0, n );
-      writePhysicalPage( page_buffer, page );
 
       nWrite -= n;
       pageOffset = 0;
@@ -618,8 +691,12 @@ void CheckedFile::extend( uint64_t newLength, OffsetMode omode )
 
 void CheckedFile::close()
 {
+   std::lock_guard<std::recursive_mutex> lock( mutex_ );
+
    if ( fd_ >= 0 )
    {
+      flushWriteBuffer();
+
 #if defined( _MSC_VER )
       int result = ::_close( fd_ );
 #elif defined( __GNUC__ )
@@ -635,6 +712,8 @@ void CheckedFile::close()
       fd_ = -1;
    }
 
+   fetchedPageCount_ = 0;
+
    if ( bufView_ != nullptr )
    {
       delete bufView_;
@@ -643,10 +722,127 @@ void CheckedFile::close()
       // WARNING: do NOT delete buffer of bufView_ because
       // pointer is handled by user !!
    }
+
+   unmapFile();
+}
+
+void CheckedFile::mapFile()
+{
+   if ( ( physicalLength_ == 0 ) || ( physicalLength_ > std::numeric_limits<size_t>::max() ) )
+   {
+      return;
+   }
+
+   const auto mapLength = static_cast<size_t>( physicalLength_ );
+
+#if defined( _WIN32 )
+   auto fileHandle = reinterpret_cast<HANDLE>( _get_osfhandle( fd_ ) );
+
+   HANDLE mapping = ::CreateFileMappingW( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+   if ( mapping == nullptr )
+   {
+      return;
+   }
+
+   // The view keeps its own reference to the mapping
+   void *base = ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, mapLength );
+   ::CloseHandle( mapping );
+
+   if ( base == nullptr )
+   {
+      return;
+   }
+#else
+   void *base = ::mmap( nullptr, mapLength, PROT_READ, MAP_SHARED, fd_, 0 );
+   if ( base == MAP_FAILED )
+   {
+      return;
+   }
+
+   ::madvise( base, mapLength, MADV_SEQUENTIAL );
+   mapSequential_ = true;
+#endif
+
+#ifdef E57_MAX_VERBOSE
+   std::cout << "CheckedFile: mapped " << mapLength << " bytes of " << fileName_ << std::endl;
+#endif
+
+   mapModificationTime_ = modificationTime();
+
+   mapBase_ = static_cast<const char *>( base );
+   mapLength_ = physicalLength_;
+
+   /// The mapping stays valid after the file is closed, so track the position using a view of it
+   bufView_ = new BufferView( mapBase_, mapLength_ );
+
+#if defined( _MSC_VER )
+   ::_close( fd_ );
+#else
+   ::close( fd_ );
+#endif
+   fd_ = -1;
+}
+
+void CheckedFile::unmapFile()
+{
+   if ( mapBase_ == nullptr )
+   {
+      return;
+   }
+
+#if defined( _WIN32 )
+   ::UnmapViewOfFile( mapBase_ );
+#else
+   ::munmap( const_cast<char *>( mapBase_ ), static_cast<size_t>( mapLength_ ) );
+#endif
+
+   mapBase_ = nullptr;
+   mapLength_ = 0;
+}
+
+const char *CheckedFile::viewPages( uint64_t page, size_t pageCount )
+{
+   const uint64_t viewLength = bufView_->size();
+
+   if ( ( page + pageCount ) * physicalPageSize > viewLength )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " page=" + toString( page ) +
+                                                      " pageCount=" + toString( pageCount ) +
+                                                      " length=" + toString( viewLength ) );
+   }
+
+#if !defined( _WIN32 )
+   if ( mapBase_ != nullptr )
+   {
+      /// Continuing from the end of the last read (which may have ended part way through a page) is sequential.
+      /// Tell the OS when the pattern changes so it can read ahead (or not).
+      const bool sequential = ( page == mapNextPage_ ) || ( page + 1 == mapNextPage_ );
+
+      mapNextPage_ = page + pageCount;
+
+      if ( sequential == mapSequential_ )
+      {
+         mapPatternChangeCount_ = 0;
+      }
+      else if ( ++mapPatternChangeCount_ >= cMapAdviceThreshold )
+      {
+         ::madvise( const_cast<char *>( mapBase_ ), static_cast<size_t>( mapLength_ ),
+                    sequential ? MADV_SEQUENTIAL : MADV_RANDOM );
+
+         mapSequential_ = sequential;
+         mapPatternChangeCount_ = 0;
+      }
+   }
+#endif
+
+   return bufView_->data() + page * physicalPageSize;
 }
 
 void CheckedFile::unlink()
 {
+   /// No point in writing out what we are about to remove
+   writeBufferPageCount_ = 0;
+
    close();
 
    /// Try to remove the file, don't report a failure
@@ -668,13 +864,9 @@ inline uint32_t swap_uint32( uint32_t val )
 }
 
 /// Calc CRC32C of given data
-uint32_t CheckedFile::checksum( char *buf, size_t size ) const
+uint32_t CheckedFile::checksum( const char *buf, size_t size ) const
 {
-   static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{ 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true };
-
-   static const CRC::Table<crcpp_uint32, 32> sCRCTable = sCRCParams.MakeTable();
-
-   auto crc = CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   auto crc = crc32c( buf, size );
 
    // (Andy) I don't understand why we need to swap bytes here
    crc = swap_uint32( crc );
@@ -682,10 +874,10 @@ uint32_t CheckedFile::checksum( char *buf, size_t size ) const
    return crc;
 }
 
-void CheckedFile::verifyChecksum( char *page_buffer, size_t page )
+void CheckedFile::verifyChecksum( const char *page_buffer, size_t page )
 {
    const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   const uint32_t check_sum_in_page = *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] );
+   const uint32_t check_sum_in_page = *reinterpret_cast<const uint32_t *>( &page_buffer[logicalPageSize] );
 
    if ( check_sum_in_page != check_sum )
    {
@@ -714,64 +906,280 @@ void CheckedFile::getCurrentPageAndOffset( uint64_t &page, size_t &pageOffset, O
    }
 }
 
-void CheckedFile::readPhysicalPage( char *page_buffer, uint64_t page )
+void CheckedFile::readPhysicalPages( char *page_buffer, uint64_t page, size_t pageCount )
 {
 #ifdef E57_MAX_VERBOSE
-   // cout << "readPhysicalPage, page:" << page << std::endl;
+   // cout << "readPhysicalPages, page:" << page << " pageCount:" << pageCount << std::endl;
 #endif
 
 #ifdef E57_CHECK_FILE_DEBUG
    const uint64_t physicalLength = length( Physical );
 
-   assert( page * physicalPageSize < physicalLength );
+   assert( ( page + pageCount ) * physicalPageSize <= physicalLength );
 #endif
 
-   /// Seek to start of physical page
-   seek( page * physicalPageSize, Physical );
+   const uint64_t physicalOffset = page * physicalPageSize;
+   const size_t byteCount = pageCount * physicalPageSize;
 
+   /// Like pread(), leave the cursor alone: callers such as read() rely on it not moving
    if ( ( fd_ < 0 ) && ( bufView_ != nullptr ) )
    {
-      bufView_->read( page_buffer, physicalPageSize );
+      const uint64_t savedPosition = position( Physical );
+
+      /// Seek to start of first physical page
+      seek( physicalOffset, Physical );
+
+      bufView_->read( page_buffer, byteCount );
+
+      seek( savedPosition, Physical );
       return;
    }
 
+#if defined( _WIN32 )
+   const uint64_t savedPosition = position( Physical );
+#endif
+
+   size_t bytesRead = 0;
+
+   while ( bytesRead < byteCount )
+   {
+#if defined( _WIN32 )
+      /// No positioned read here, so seek to where we left off
+      seek( physicalOffset + bytesRead, Physical );
+
 #if defined( _MSC_VER )
-   int result = ::_read( fd_, page_buffer, physicalPageSize );
-#elif defined( __GNUC__ )
-   ssize_t result = ::read( fd_, page_buffer, physicalPageSize );
+      int result = ::_read( fd_, page_buffer + bytesRead, static_cast<unsigned int>( byteCount - bytesRead ) );
 #else
-#error "no supported compiler defined"
+      ssize_t result = ::read( fd_, page_buffer + bytesRead, byteCount - bytesRead );
+#endif
+#elif defined( __linux__ )
+      ssize_t result = ::pread64( fd_, page_buffer + bytesRead, byteCount - bytesRead,
+                                  static_cast<off64_t>( physicalOffset + bytesRead ) );
+#elif defined( __APPLE__ ) || defined( __BSD )
+      ssize_t result = ::pread( fd_, page_buffer + bytesRead, byteCount - bytesRead,
+                                static_cast<off_t>( physicalOffset + bytesRead ) );
+#else
+#error "no supported OS platform defined"
 #endif
 
-   if ( result < 0 || static_cast<size_t>( result ) != physicalPageSize )
+      /// A short read is only OK if we can keep going, running out of file is an error
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " result=" + toString( result ) +
+                                                         " page=" + toString( page ) +
+                                                         " pageCount=" + toString( pageCount ) );
+      }
+
+      bytesRead += static_cast<size_t>( result );
+   }
+
+#if defined( _WIN32 )
+   seek( savedPosition, Physical );
+#endif
+}
+
+const char *CheckedFile::fetchPages( uint64_t page, size_t pageCount )
+{
+   const uint64_t fetchedEnd = fetchedFirstPage_ + fetchedPageCount_;
+
+   /// Pages we already have are not read or verified again
+   const bool startFetched = ( fetchedPageCount_ > 0 ) && ( page >= fetchedFirstPage_ ) && ( page < fetchedEnd );
+
+   if ( startFetched && ( page + pageCount <= fetchedEnd ) )
+   {
+      if ( bufView_ != nullptr )
+      {
+         return bufView_->data() + page * physicalPageSize;
+      }
+
+      return &readBuffer_[( page - fetchedFirstPage_ ) * physicalPageSize];
+   }
+
+   const size_t keepCount = startFetched ? static_cast<size_t>( fetchedEnd - page ) : 0;
+
+   const char *page_buffer = nullptr;
+
+   /// Forget what we had in case a read or checksum fails below
+   fetchedPageCount_ = 0;
+
+   if ( bufView_ != nullptr )
    {
-      throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " result=" + toString( result ) );
+      viewPages( page + keepCount, pageCount - keepCount );
+
+      page_buffer = bufView_->data() + page * physicalPageSize;
    }
+   else
+   {
+      if ( readBuffer_.size() < pageCount * physicalPageSize )
+      {
+         readBuffer_.resize( pageCount * physicalPageSize );
+      }
+
+      /// Slide the pages we are keeping to the front & read the rest after them
+      if ( keepCount > 0 )
+      {
+         memmove( &readBuffer_[0], &readBuffer_[( page - fetchedFirstPage_ ) * physicalPageSize],
+                  keepCount * physicalPageSize );
+      }
+
+      readPhysicalPages( &readBuffer_[keepCount * physicalPageSize], page + keepCount, pageCount - keepCount );
+
+      page_buffer = &readBuffer_[0];
+   }
+
+   /// Verify the checksum of each new page
+   const auto checksumMod = static_cast<const unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
+
+   for ( size_t i = keepCount; i < pageCount; ++i )
+   {
+      const uint64_t currentPage = page + i;
+
+      switch ( checkSumPolicy_ )
+      {
+         case ChecksumPolicy::None:
+            break;
+
+         case ChecksumPolicy::All:
+            verifyChecksum( page_buffer + i * physicalPageSize, currentPage );
+            break;
+
+         default:
+            if ( !( currentPage % checksumMod ) || ( i == pageCount - 1 ) )
+            {
+               verifyChecksum( page_buffer + i * physicalPageSize, currentPage );
+            }
+            break;
+      }
+   }
+
+   fetchedFirstPage_ = page;
+   fetchedPageCount_ = pageCount;
+
+   return page_buffer;
+}
+
+char *CheckedFile::writeBufferPage( uint64_t page )
+{
+   /// Already buffered?
+   if ( ( page >= writeBufferFirstPage_ ) && ( page < writeBufferFirstPage_ + writeBufferPageCount_ ) )
+   {
+      return &writeBuffer_[( page - writeBufferFirstPage_ ) * physicalPageSize];
+   }
+
+   /// Start a new run unless this page extends the current one
+   if ( ( writeBufferPageCount_ == 0 ) || ( page != writeBufferFirstPage_ + writeBufferPageCount_ ) ||
+        ( writeBufferPageCount_ == writeBufferMaxPageCount ) )
+   {
+      flushWriteBuffer();
+
+      writeBufferFirstPage_ = page;
+   }
+
+   const size_t offset = writeBufferPageCount_ * physicalPageSize;
+
+   if ( writeBuffer_.size() < offset + physicalPageSize )
+   {
+      writeBuffer_.resize( offset + physicalPageSize );
+   }
+
+   char *page_buffer = &writeBuffer_[offset];
+
+   /// Start from the current contents if the page is already in the file
+   if ( page * physicalPageSize < physicalLength_ )
+   {
+      readPhysicalPages( page_buffer, page, 1 );
+   }
+   else
+   {
+      memset( page_buffer, 0, physicalPageSize );
+   }
+
+   ++writeBufferPageCount_;
+
+   return page_buffer;
+}
+
+void CheckedFile::flushWriteBuffer()
+{
+   if ( writeBufferPageCount_ == 0 )
+   {
+      return;
+   }
+
+#ifdef E57_MAX_VERBOSE
+   // cout << "flushWriteBuffer, page:" << writeBufferFirstPage_ << " pageCount:" << writeBufferPageCount_ <<
+   // std::endl;
+#endif
+
+   const size_t pageCount = writeBufferPageCount_;
+
+   /// Clear it first so a failure below doesn't leave us trying to flush again on close
+   writeBufferPageCount_ = 0;
+
+   /// Anything we fetched for reading may be out of date now
+   fetchedPageCount_ = 0;
+
+   /// Append checksums
+   for ( size_t i = 0; i < pageCount; ++i )
+   {
+      char *page_buffer = &writeBuffer_[i * physicalPageSize];
+
+      uint32_t check_sum = checksum( page_buffer, logicalPageSize );
+      *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] ) = check_sum; //??? little endian dependency
+   }
+
+   writePhysicalPages( &writeBuffer_[0], writeBufferFirstPage_, pageCount );
+
+   physicalLength_ = std::max( physicalLength_, ( writeBufferFirstPage_ + pageCount ) * physicalPageSize );
 }
 
-void CheckedFile::writePhysicalPage( char *page_buffer, uint64_t page )
+void CheckedFile::writePhysicalPages( const char *page_buffer, uint64_t page, size_t pageCount )
 {
 #ifdef E57_MAX_VERBOSE
-   // cout << "writePhysicalPage, page:" << page << std::endl;
+   // cout << "writePhysicalPages, page:" << page << " pageCount:" << pageCount << std::endl;
+#endif
+
+   const uint64_t physicalOffset = page * physicalPageSize;
+   const size_t byteCount = pageCount * physicalPageSize;
+
+   /// Like pwrite(), leave the cursor alone, since the write buffer may be flushed in the middle of read() or write()
+#if defined( _WIN32 )
+   const uint64_t savedPosition = position( Physical );
 #endif
 
-   /// Append checksum
-   uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   *reinterpret_cast<uint32_t *>( &page_buffer[logicalPageSize] ) = check_sum; //??? little endian dependency
+   size_t bytesWritten = 0;
 
-   /// Seek to start of physical page
-   seek( page * physicalPageSize, Physical );
+   while ( bytesWritten < byteCount )
+   {
+#if defined( _WIN32 )
+      /// No positioned write here, so seek to where we left off
+      seek( physicalOffset + bytesWritten, Physical );
 
 #if defined( _MSC_VER )
-   int result = ::_write( fd_, page_buffer, physicalPageSize );
-#elif defined( __GNUC__ )
-   ssize_t result = ::write( fd_, page_buffer, physicalPageSize );
+      int result =
+         ::_write( fd_, page_buffer + bytesWritten, static_cast<unsigned int>( byteCount - bytesWritten ) );
 #else
-#error "no supported compiler defined"
+      ssize_t result = ::write( fd_, page_buffer + bytesWritten, byteCount - bytesWritten );
+#endif
+#elif defined( __linux__ )
+      ssize_t result = ::pwrite64( fd_, page_buffer + bytesWritten, byteCount - bytesWritten,
+                                   static_cast<off64_t>( physicalOffset + bytesWritten ) );
+#elif defined( __APPLE__ ) || defined( __BSD )
+      ssize_t result = ::pwrite( fd_, page_buffer + bytesWritten, byteCount - bytesWritten,
+                                 static_cast<off_t>( physicalOffset + bytesWritten ) );
+#else
+#error "no supported OS platform defined"
 #endif
 
-   if ( result < 0 )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_WRITE_FAILED, "fileName=" + fileName_ + " result=" + toString( result ) );
+      if ( result < 0 )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_WRITE_FAILED, "fileName=" + fileName_ + " result=" + toString( result ) );
+      }
+
+      bytesWritten += static_cast<size_t>( result );
    }
+
+#if defined( _WIN32 )
+   seek( savedPosition, Physical );
+#endif
 }
@@ -28,6 +28,7 @@
 #pragma once
 
 #include <algorithm>
+#include <mutex>
 
 #include "Common.h"
 
@@ -47,10 +48,18 @@ namespace e57
       static constexpr uint64_t physicalPageSizeMask = physicalPageSize - 1;
       static constexpr size_t logicalPageSize = physicalPageSize - 4;
 
+      /// Maximum number of physical pages fetched by a single read() system call.
+      /// Large enough that a full data packet comes in with one call.
+      static constexpr size_t readBatchPageCount = 128;
+
+      /// Maximum number of physical pages held by the write buffer before they are written to the file.
+      static constexpr size_t writeBufferMaxPageCount = 4096;
+
    public:
       enum Mode
       {
          ReadOnly,
+         ReadOnlyMapped, ///< read-only, mapping the whole file into memory if possible
          WriteCreate,
          WriteExisting
       };
@@ -66,7 +75,9 @@ namespace e57
       ~CheckedFile();
 
       void read( char *buf, size_t nRead, size_t bufSize = 0 );
+      void readAt( uint64_t logicalOffset, char *buf, size_t nRead );
       void write( const char *buf, size_t nWrite );
+      void writeAt( uint64_t logicalOffset, const char *buf, size_t nWrite );
       CheckedFile &operator<<( const e57::ustring &s );
       CheckedFile &operator<<( int64_t i );
       CheckedFile &operator<<( uint64_t i );
@@ -77,6 +88,9 @@ namespace e57
       uint64_t length( OffsetMode omode = Logical );
       void extend( uint64_t newLength, OffsetMode omode = Logical );
 
+      /// Last modification time of the file in seconds since the epoch, 0 if unknown (e.g. reading from a buffer)
+      int64_t modificationTime();
+
       e57::ustring fileName() const
       {
          return fileName_;
@@ -89,17 +103,27 @@ namespace e57
       static inline uint64_t physicalToLogical( uint64_t physicalOffset );
 
    private:
-      uint32_t checksum( char *buf, size_t size ) const;
-      void verifyChecksum( char *page_buffer, size_t page );
+      uint32_t checksum( const char *buf, size_t size ) const;
+      void verifyChecksum( const char *page_buffer, size_t page );
 
       template <class FTYPE> CheckedFile &writeFloatingPoint( FTYPE value, int precision );
 
       void getCurrentPageAndOffset( uint64_t &page, size_t &pageOffset, OffsetMode omode = Logical );
-      void readPhysicalPage( char *page_buffer, uint64_t page );
-      void writePhysicalPage( char *page_buffer, uint64_t page );
+      void readPhysicalPages( char *page_buffer, uint64_t page, size_t pageCount );
+      void writePhysicalPages( const char *page_buffer, uint64_t page, size_t pageCount );
+      const char *fetchPages( uint64_t page, size_t pageCount );
+      char *writeBufferPage( uint64_t page );
+      void flushWriteBuffer();
       int open64( const e57::ustring &fileName, int flags, int mode );
+      void mapFile();
+      void unmapFile();
+      const char *viewPages( uint64_t page, size_t pageCount );
       uint64_t lseek64( int64_t offset, int whence );
 
+      /// Serializes access so a background thread may write while the owner carries on.
+      /// Recursive since the public functions use each other.
+      std::recursive_mutex mutex_;
+
       e57::ustring fileName_;
       uint64_t logicalLength_ = 0;
       uint64_t physicalLength_ = 0;
@@ -109,6 +133,32 @@ namespace e57
       int fd_ = -1;
       BufferView *bufView_ = nullptr;
       bool readOnly_ = false;
+
+      /// Staging buffer for read(), holds up to readBatchPageCount physical pages
+      std::vector<char> readBuffer_;
+
+      /// Run of physical pages which have been fetched & verified by the last read().
+      /// Reading them again costs neither I/O nor checksums. They are in readBuffer_ unless bufView_ is used.
+      uint64_t fetchedFirstPage_ = 0;
+      size_t fetchedPageCount_ = 0;
+
+      /// Write buffer holding a run of contiguous physical pages which have not been written to the file yet.
+      /// Checksums are calculated when the pages are flushed.
+      std::vector<char> writeBuffer_;
+      uint64_t writeBufferFirstPage_ = 0;
+      size_t writeBufferPageCount_ = 0;
+
+      /// Memory mapped file (ReadOnlyMapped), bufView_ provides the pages & tracks the position within it
+      const char *mapBase_ = nullptr;
+      uint64_t mapLength_ = 0;
+
+      /// The file is closed once it's mapped, so its modification time is kept from before then
+      int64_t mapModificationTime_ = 0;
+
+      /// Access pattern tracking so we can tell the OS whether to read ahead
+      uint64_t mapNextPage_ = 0;
+      bool mapSequential_ = true;
+      int mapPatternChangeCount_ = 0;
    };
 
    inline uint64_t CheckedFile::logicalToPhysical( uint64_t logicalOffset )
@@ -390,12 +390,21 @@ prototype.
 It is an error to call this function if the CompressedVectorNode already has any
 records (i.e. a CompressedVectorNode cannot be set twice).
 
+Writers of different CompressedVectorNodes may be open at once, and each may be
+used on a different thread (but a single writer must not be used by two threads
+at the same time). Since each node's data must be contiguous in the file, the
+first writer writes straight to the end of the file. The others keep their data
+in a temporary file until they are closed & the end of the file is free, when it
+is copied there. Nodes must still be created & attached on one thread at a time,
+and the ImageFile must not be closed while any writers are open.
+
 @pre     @a sbufs can't be empty (i.e. sbufs.length() > 0).
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre     The @a destImageFile must have been opened in write mode (i.e.
 destImageFile.isWritable()).
-@pre     The destination ImageFile can't have any readers or writers open
-(destImageFile().readerCount()==0 && destImageFile().writerCount()==0)
+@pre     The destination ImageFile can't have any readers open
+(destImageFile().readerCount()==0)
+@pre     This CompressedVectorNode can't have a writer open
 @pre     This CompressedVectorNode must be attached (i.e. isAttached()).
 @pre     This CompressedVectorNode must have no records (i.e. childCount() ==
 0).
@@ -433,16 +442,26 @@ CompressedVectorNode's prototype. It is an error for two SourceDestBuffers in @a
 dbufs to identify the same terminal node in the prototype. It is not an error to
 create a CompressedVectorReader for an empty CompressedVectorNode.
 
+An ImageFile opened for reading may have any number of CompressedVectorReaders
+open at once, of the same or different CompressedVectorNodes. Each reader may be
+used on a different thread (but a single reader must not be used by two threads
+at the same time). Readers may also be created & closed on different threads,
+as long as the ImageFile isn't closed while any of them are. An ImageFile being
+written may only have one reader open at a time.
+
 @pre     @a dbufs can't be empty
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre     The destination ImageFile can't have any writers open
 (destImageFile().writerCount()==0)
+@pre     If the destination ImageFile is being written, it can't have any readers
+open (destImageFile().readerCount()==0)
 @pre     This CompressedVectorNode must be attached (i.e. isAttached()).
 @return  A smart CompressedVectorReader handle referencing the underlying
 iterator object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
 @throw   ::E57_ERROR_TOO_MANY_WRITERS
+@throw   ::E57_ERROR_TOO_MANY_READERS
 @throw   ::E57_ERROR_NODE_UNATTACHED
 @throw   ::E57_ERROR_PATH_UNDEFINED
 @throw   ::E57_ERROR_BUFFER_SIZE_MISMATCH
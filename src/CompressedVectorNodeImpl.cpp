@@ -264,13 +264,13 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      /// Check don't have any writers/readers open for this ImageFile
-      if ( destImageFile->writerCount() > 0 )
+      /// Check don't have any readers open for this ImageFile, or another writer for this node. Writers of other
+      /// nodes are fine, they take turns appending their sections to the file.
+      if ( writerOpen_ )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
-                               "fileName=" + destImageFile->fileName() +
-                                  " writerCount=" + toString( destImageFile->writerCount() ) +
-                                  " readerCount=" + toString( destImageFile->readerCount() ) );
+                               "fileName=" + destImageFile->fileName() + " this->pathName=" + this->pathName() +
+                                  " writerCount=" + toString( destImageFile->writerCount() ) );
       }
       if ( destImageFile->readerCount() > 0 )
       {
@@ -313,7 +313,7 @@ namespace e57
 
       ImageFileImplSharedPtr destImageFile( destImageFile_ );
 
-      /// Check don't have any writers/readers open for this ImageFile
+      /// Check don't have any writers open for this ImageFile
       if ( destImageFile->writerCount() > 0 )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_WRITERS,
@@ -321,7 +321,9 @@ namespace e57
                                   " writerCount=" + toString( destImageFile->writerCount() ) +
                                   " readerCount=" + toString( destImageFile->readerCount() ) );
       }
-      if ( destImageFile->readerCount() > 0 )
+
+      /// A file being written only allows one reader at a time. Read-only files may have any number.
+      if ( destImageFile->isWriter() && ( destImageFile->readerCount() > 0 ) )
       {
          throw E57_EXCEPTION2( E57_ERROR_TOO_MANY_READERS,
                                "fileName=" + destImageFile->fileName() +
@@ -81,6 +81,12 @@ namespace e57
          binarySectionLogicalStart_ = binarySectionLogicalStart;
       }
 
+      /// Set while a CompressedVectorWriter is writing to this node
+      void setWriterOpen( bool writerOpen )
+      {
+         writerOpen_ = writerOpen;
+      }
+
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) const override;
 #endif
@@ -93,5 +99,6 @@ namespace e57
 
       int64_t recordCount_ = 0;
       uint64_t binarySectionLogicalStart_ = 0;
+      bool writerOpen_ = false;
    };
 }
@@ -62,6 +62,10 @@ It is recommended to call CompressedVectorReader::close to gracefully end the
 transfer. Unlike the CompressedVectorWriter, not all fields in the record of the
 CompressedVectorNode are required to be read at one time.
 
+Several CompressedVectorReaders may be open on an ImageFile opened for reading,
+for example to read each scan of a file on its own thread. See
+CompressedVectorNode::reader.
+
 @section CompressedVectorReader_invariant Class Invariant
 A class invariant is a list of statements about an object that are always true
 before and after any operation on the object. An invariant is useful for testing
@@ -225,6 +229,11 @@ CompressedVectorReader are open). The next read will start at the given
 recordNumber. It is not an error to seek to recordNumber = childCount() (i.e. to
 one record past end of CompressedVectorNode).
 
+If the binary section has index packets, they are used to go straight to the
+data packet holding the record. Otherwise the data packets are walked from the
+start of the section, which only needs their headers for channels whose records
+are all the same size.
+
 @pre     @a recordNumber <= childCount() of CompressedVectorNode.
 @pre     The associated ImageFile must be open.
 @pre     This CompressedVectorReader must be open (i.e isOpen())
@@ -25,17 +25,28 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "CompressedVectorReaderImpl.h"
 #include "CheckedFile.h"
 #include "CompressedVectorNodeImpl.h"
 #include "ImageFileImpl.h"
 #include "Packet.h"
+#include "PacketIndex.h"
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
 #include "StringFunctions.h"
+#include "ThreadPool.h"
 
 namespace e57
 {
+   /// Number of packets cached by each reader decoding part of a parallel read()
+   constexpr unsigned cWorkerCachePacketCount = 8;
+
+   /// Fewer bytes than this from a packet aren't worth sharing out between threads
+   constexpr size_t cMinParallelFeedLength = 16 * 1024;
+
    CompressedVectorReaderImpl::CompressedVectorReaderImpl( std::shared_ptr<CompressedVectorNodeImpl> cvi,
                                                            std::vector<SourceDestBuffer> &dbufs ) :
       isOpen_( false ), // set to true when succeed below
@@ -66,38 +77,16 @@ namespace e57
       /// Check dbufs well formed (matches proto exactly)
       setBuffers( dbufs );
 
-      /// For each dbuf, create an appropriate Decoder based on the cVector_
-      /// attributes
-      for ( unsigned i = 0; i < dbufs_.size(); i++ )
-      {
-         std::vector<SourceDestBuffer> theDbuf;
-         theDbuf.push_back( dbufs.at( i ) );
-
-         std::shared_ptr<Decoder> decoder = Decoder::DecoderFactory( i, cVector_.get(), theDbuf, ustring() );
-
-         /// Calc which stream the given path belongs to.  This depends on position
-         /// of the node in the proto tree.
-         NodeImplSharedPtr readNode = proto_->get( dbufs.at( i ).pathName() );
-         uint64_t bytestreamNumber = 0;
-         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "dbufIndex=" + toString( i ) );
-         }
-
-         channels_.emplace_back( dbufs.at( i ), decoder, static_cast<unsigned>( bytestreamNumber ),
-                                 cVector_->childCount() );
-      }
+      createChannels( dbufs );
 
       recordCount_ = 0;
+      nextRecordNumber_ = 0;
 
       /// Get how many records are actually defined
       maxRecordCount_ = cvi->childCount();
 
       ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
 
-      //??? what if fault in this constructor?
-      cache_ = new PacketReadCache( imf->file_, 32 );
-
       /// Read CompressedVector section header
       CompressedVectorSectionHeader sectionHeader;
       uint64_t sectionLogicalStart = cVector_->getBinarySectionLogicalStart();
@@ -109,8 +98,7 @@ namespace e57
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
                                "imageFileName=" + cVector_->imageFileName() + " cvPathName=" + cVector_->pathName() );
       }
-      imf->file_->seek( sectionLogicalStart, CheckedFile::Logical );
-      imf->file_->read( reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
+      imf->file_->readAt( sectionLogicalStart, reinterpret_cast<char *>( &sectionHeader ), sizeof( sectionHeader ) );
 
 #ifdef E57_DEBUG
       sectionHeader.verify( imf->file_->length( CheckedFile::Physical ) );
@@ -122,11 +110,28 @@ namespace e57
       /// Convert physical offset to first data packet to logical
       uint64_t dataLogicalOffset = imf->file_->physicalToLogical( sectionHeader.dataPhysicalOffset );
 
+      dataLogicalOffset_ = dataLogicalOffset;
+
+      /// Remember where the index is for seek()
+      indexLogicalOffset_ = 0;
+      if ( sectionHeader.indexPhysicalOffset != 0 )
+      {
+         indexLogicalOffset_ = imf->file_->physicalToLogical( sectionHeader.indexPhysicalOffset );
+      }
+
+      if ( imf->readAheadPacketCount_ > 0 )
+      {
+         readAhead_.reset( new PacketReadAhead( imf->file_, sectionEndLogicalOffset_, imf->readAheadPacketCount_ ) );
+      }
+
+      cache_ = imf->acquirePacketCache( ownCache_ );
+
       /// Verify that packet given by dataPhysicalOffset is actually a data packet,
       /// init channels
+      try
       {
          char *anyPacket = nullptr;
-         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset, anyPacket );
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( dataLogicalOffset, anyPacket, readAhead_.get() );
 
          auto dpkt = reinterpret_cast<DataPacket *>( anyPacket );
 
@@ -144,6 +149,12 @@ namespace e57
             channel.currentBytestreamBufferLength = dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
          }
       }
+      catch ( ... )
+      {
+         /// We won't be closed, so give the cache back now
+         imf->releasePacketCache( cache_ );
+         throw;
+      }
 
       /// Just before return (and can't throw) increment reader count  ??? safer
       /// way to assure don't miss close?
@@ -153,6 +164,30 @@ namespace e57
       isOpen_ = true;
    }
 
+   CompressedVectorReaderImpl::CompressedVectorReaderImpl( const CompressedVectorReaderImpl &parent,
+                                                           std::vector<SourceDestBuffer> &dbufs ) :
+      isOpen_( false ), cVector_( parent.cVector_ ), proto_( parent.proto_ ), cache_( nullptr ), recordCount_( 0 ),
+      maxRecordCount_( parent.maxRecordCount_ ), sectionEndLogicalOffset_( parent.sectionEndLogicalOffset_ ),
+      dataLogicalOffset_( parent.dataLogicalOffset_ ), indexLogicalOffset_( parent.indexLogicalOffset_ ),
+      nextRecordNumber_( 0 ), chunkRecordNumbers_( parent.chunkRecordNumbers_ ),
+      chunkLogicalOffsets_( parent.chunkLogicalOffsets_ )
+   {
+      /// The parent has already checked everything, read the section header & loaded the chunks, so all we need
+      /// are decoders and somewhere to put packets. The channels are positioned by seek() before each read().
+      dbufs_ = dbufs;
+
+      createChannels( dbufs );
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      /// The ImageFile's cache isn't thread safe, but its budget is
+      workerCache_.reset( new PacketReadCache( imf->file_, cWorkerCachePacketCount, imf->packetCacheBudget() ) );
+      cache_ = workerCache_.get();
+
+      /// Workers aren't counted as readers of the ImageFile, their parent is
+      isOpen_ = true;
+   }
+
    CompressedVectorReaderImpl::~CompressedVectorReaderImpl()
    {
 #ifdef E57_MAX_VERBOSE
@@ -203,6 +238,31 @@ namespace e57
       dbufs_ = dbufs;
    }
 
+   void CompressedVectorReaderImpl::createChannels( std::vector<SourceDestBuffer> &dbufs )
+   {
+      /// For each dbuf, create an appropriate Decoder based on the cVector_
+      /// attributes
+      for ( unsigned i = 0; i < dbufs.size(); i++ )
+      {
+         std::vector<SourceDestBuffer> theDbuf;
+         theDbuf.push_back( dbufs.at( i ) );
+
+         std::shared_ptr<Decoder> decoder = Decoder::DecoderFactory( i, cVector_.get(), theDbuf, ustring() );
+
+         /// Calc which stream the given path belongs to.  This depends on position
+         /// of the node in the proto tree.
+         NodeImplSharedPtr readNode = proto_->get( dbufs.at( i ).pathName() );
+         uint64_t bytestreamNumber = 0;
+         if ( !proto_->findTerminalPosition( readNode, bytestreamNumber ) )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "dbufIndex=" + toString( i ) );
+         }
+
+         channels_.emplace_back( dbufs.at( i ), decoder, static_cast<unsigned>( bytestreamNumber ),
+                                 cVector_->childCount() );
+      }
+   }
+
    unsigned CompressedVectorReaderImpl::read( std::vector<SourceDestBuffer> &dbufs )
    {
       /// don't checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__), read() will
@@ -230,6 +290,13 @@ namespace e57
          dbuf.impl()->rewind();
       }
 
+      unsigned outputCount = 0;
+
+      if ( readParallel( outputCount ) )
+      {
+         return outputCount;
+      }
+
       /// Allow decoders to use data they already have in their queue to fill newly
       /// empty dbufs This helps to keep decoder input queues smaller, which
       /// reduces backtracking in the packet cache.
@@ -258,7 +325,6 @@ namespace e57
       }
 
       /// Verify that each channel produced the same number of records
-      unsigned outputCount = 0;
       for ( unsigned i = 0; i < channels_.size(); i++ )
       {
          DecodeChannel *chan = &channels_[i];
@@ -276,10 +342,168 @@ namespace e57
          }
       }
 
+      nextRecordNumber_ += outputCount;
+
       /// Return number of records transferred to each dbuf.
       return outputCount;
    }
 
+   bool CompressedVectorReaderImpl::readParallel( unsigned &outputCount )
+   {
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      /// Only chunks listed in the index packets can be decoded independently. Readers already working on part of
+      /// a parallel read don't split it up again.
+      if ( ( imf->decodeThreadCount_ < 2 ) || ( indexLogicalOffset_ == 0 ) || workerCache_ )
+      {
+         return false;
+      }
+
+      /// Strings can't be split between buffers
+      size_t capacity = std::numeric_limits<size_t>::max();
+
+      for ( auto &dbuf : dbufs_ )
+      {
+         if ( dbuf.impl()->memoryRepresentation() == E57_USTRING )
+         {
+            return false;
+         }
+
+         capacity = std::min( capacity, dbuf.impl()->capacity() );
+      }
+
+      const uint64_t firstRecordNumber = nextRecordNumber_;
+      const uint64_t endRecordNumber = std::min<uint64_t>( firstRecordNumber + capacity, maxRecordCount_ );
+
+      if ( chunkRecordNumbers_.empty() )
+      {
+         loadChunks( indexLogicalOffset_, E57_UINT32_MAX );
+
+         if ( !std::is_sorted( chunkRecordNumbers_.begin(), chunkRecordNumbers_.end() ) )
+         {
+            const size_t chunkCount = chunkRecordNumbers_.size();
+
+            /// Don't let seek() use them either
+            chunkRecordNumbers_.clear();
+            chunkLogicalOffsets_.clear();
+
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "chunkCount=" + toString( chunkCount ) );
+         }
+      }
+
+      /// The read can be split where chunks start inside it. It's not worth setting up other readers unless it
+      /// covers at least one whole chunk.
+      const auto firstSplit =
+         std::upper_bound( chunkRecordNumbers_.begin(), chunkRecordNumbers_.end(), firstRecordNumber );
+      const auto endSplit = std::lower_bound( firstSplit, chunkRecordNumbers_.end(), endRecordNumber );
+
+      if ( std::distance( firstSplit, endSplit ) < 2 )
+      {
+         return false;
+      }
+
+      /// Split it into at most decodeThreadCount tasks of about the same number of records
+      const uint64_t recordCount = endRecordNumber - firstRecordNumber;
+      const uint64_t taskCount = std::min<uint64_t>( imf->decodeThreadCount_, ( endSplit - firstSplit ) + 1 );
+
+      std::vector<uint64_t> taskStarts( 1, firstRecordNumber );
+
+      for ( uint64_t i = 1; i < taskCount; ++i )
+      {
+         const auto split = std::lower_bound( firstSplit, endSplit, firstRecordNumber + recordCount * i / taskCount );
+
+         if ( ( split != endSplit ) && ( *split > taskStarts.back() ) )
+         {
+            taskStarts.push_back( *split );
+         }
+      }
+
+      taskStarts.push_back( endRecordNumber );
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "CompressedVectorReaderImpl::readParallel() firstRecordNumber=" << firstRecordNumber
+                << " endRecordNumber=" << endRecordNumber << " taskCount=" << taskStarts.size() - 1 << std::endl;
+#endif
+
+      /// Each task gets its own reader (and decoders) writing into its part of the buffers. They are set up here
+      /// the first time they are needed, and kept for later reads.
+      const size_t workerCount = taskStarts.size() - 1;
+
+      for ( size_t i = 0; i < workerCount; ++i )
+      {
+         std::vector<SourceDestBuffer> slices;
+
+         for ( auto &dbuf : dbufs_ )
+         {
+            slices.push_back( SourceDestBuffer( dbuf.impl()->slice(
+               static_cast<size_t>( taskStarts[i] - firstRecordNumber ),
+               static_cast<size_t>( taskStarts[i + 1] - taskStarts[i] ) ) ) );
+         }
+
+         if ( i < workers_.size() )
+         {
+            workers_[i]->setWorkerBuffers( slices );
+         }
+         else
+         {
+            workers_.emplace_back( new CompressedVectorReaderImpl( *this, slices ) );
+         }
+      }
+
+      {
+         TaskGroup tasks( imf->decodeExecutor() );
+
+         for ( size_t i = 0; i < workerCount; ++i )
+         {
+            CompressedVectorReaderImpl *worker = workers_[i].get();
+
+            const uint64_t startRecordNumber = taskStarts[i];
+            const uint64_t taskRecordCount = taskStarts[i + 1] - startRecordNumber;
+
+            tasks.run( [worker, startRecordNumber, taskRecordCount] {
+               worker->seek( startRecordNumber );
+
+               const unsigned count = worker->read();
+
+               if ( count != taskRecordCount )
+               {
+                  throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "startRecordNumber=" + toString( startRecordNumber ) +
+                                                               " count=" + toString( count ) +
+                                                               " expected=" + toString( taskRecordCount ) );
+               }
+            } );
+         }
+
+         tasks.wait();
+      }
+
+      /// Carry on after what we just read
+      seek( endRecordNumber );
+
+      outputCount = static_cast<unsigned>( recordCount );
+
+      for ( auto &dbuf : dbufs_ )
+      {
+         dbuf.impl()->setNextIndex( outputCount );
+      }
+
+      return true;
+   }
+
+   void CompressedVectorReaderImpl::setWorkerBuffers( std::vector<SourceDestBuffer> &dbufs )
+   {
+      /// The slices come from the parent's buffers, so they have already been checked
+      dbufs_ = dbufs;
+
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         std::vector<SourceDestBuffer> theDbuf( 1, dbufs.at( i ) );
+
+         channels_[i].dbuf = dbufs.at( i );
+         channels_[i].decoder->destBufferSetNew( theDbuf );
+      }
+   }
+
    uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
    {
       uint64_t earliestPacketLogicalOffset = E57_UINT64_MAX;
@@ -323,7 +547,7 @@ namespace e57
    {
       char *packet = nullptr;
 
-      std::unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet );
+      std::unique_ptr<PacketLock> packetLock = cache_->lock( inLogicalOffset, packet, readAhead_.get() );
 
       return reinterpret_cast<DataPacket *>( packet );
    }
@@ -333,6 +557,56 @@ namespace e57
       return ( ( channel.currentPacketLogicalOffset != currentPacketLogicalOffset ) || channel.isOutputBlocked() );
    }
 
+   inline size_t _uneatenLength( const DecodeChannel &channel )
+   {
+      return channel.currentBytestreamBufferLength - channel.currentBytestreamBufferIndex;
+   }
+
+   /// Feed a channel's bytestream buffer from the packet into its decoder.
+   /// Only touches the channel, so channels may be fed on different threads.
+   void _feedChannel( DecodeChannel &channel, DataPacket *dpkt )
+   {
+      // Get bytestream buffer for this channel from packet
+      unsigned int bsbLength = 0;
+      const char *bsbStart = dpkt->getBytestream( channel.bytestreamNumber, bsbLength );
+
+      // Double check we are not off end of buffer
+      if ( channel.currentBytestreamBufferIndex > bsbLength )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
+                               "currentBytestreamBufferIndex =" + toString( channel.currentBytestreamBufferIndex ) +
+                                  " bsbLength=" + toString( bsbLength ) );
+      }
+
+      // Calc where we are in the buffer
+      const char *uneatenStart = &bsbStart[channel.currentBytestreamBufferIndex];
+      const size_t uneatenLength = bsbLength - channel.currentBytestreamBufferIndex;
+
+      if ( &uneatenStart[uneatenLength] > &bsbStart[bsbLength] )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
+                               "uneatenLength=" + toString( uneatenLength ) + " bsbLength=" + toString( bsbLength ) );
+      }
+
+      // Feed into decoder
+      const size_t bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "  stream[" << channel.bytestreamNumber << "]: feeding decoder " << uneatenLength << " bytes"
+                << std::endl;
+
+      if ( uneatenLength == 0 )
+      {
+         channel.dump( 8 );
+      }
+
+      std::cout << "  stream[" << channel.bytestreamNumber << "]: bytesProcessed=" << bytesProcessed << std::endl;
+#endif
+
+      // Adjust counts of bytestream location
+      channel.currentBytestreamBufferIndex += bytesProcessed;
+   }
+
    void CompressedVectorReaderImpl::feedPacketToDecoders( uint64_t currentPacketLogicalOffset )
    {
       // Get packet at currentPacketLogicalOffset into memory.
@@ -346,64 +620,38 @@ namespace e57
 
       // Read earliest packet into cache and send data to decoders with unblocked output
 
-      bool anyChannelHasExhaustedPacket = false;
-      uint64_t nextPacketLogicalOffset = E57_UINT64_MAX;
+      // Find channels with unblocked output that are reading from this packet
+      std::vector<DecodeChannel *> hungryChannels;
 
-      // Feed bytestreams to channels with unblocked output that are reading from this packet
       for ( DecodeChannel &channel : channels_ )
       {
          // Skip channels that have already read this packet.
-         if ( _alreadyReadPacket( channel, currentPacketLogicalOffset ) )
+         if ( !_alreadyReadPacket( channel, currentPacketLogicalOffset ) )
          {
-            continue;
+            hungryChannels.push_back( &channel );
          }
+      }
 
-         // Get bytestream buffer for this channel from packet
-         unsigned int bsbLength = 0;
-         const char *bsbStart = dpkt->getBytestream( channel.bytestreamNumber, bsbLength );
-
-         // Double check we are not off end of buffer
-         if ( channel.currentBytestreamBufferIndex > bsbLength )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_INTERNAL,
-                                  "currentBytestreamBufferIndex =" + toString( channel.currentBytestreamBufferIndex ) +
-                                     " bsbLength=" + toString( bsbLength ) );
-         }
-
-         // Calc where we are in the buffer
-         const char *uneatenStart = &bsbStart[channel.currentBytestreamBufferIndex];
-         const size_t uneatenLength = bsbLength - channel.currentBytestreamBufferIndex;
-
-         if ( &uneatenStart[uneatenLength] > &bsbStart[bsbLength] )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "uneatenLength=" + toString( uneatenLength ) +
-                                                         " bsbLength=" + toString( bsbLength ) );
-         }
-
-         // Feed into decoder
-         const size_t bytesProcessed = channel.decoder->inputProcess( uneatenStart, uneatenLength );
-
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  stream[" << channel.bytestreamNumber << "]: feeding decoder " << uneatenLength << " bytes"
-                   << std::endl;
-
-         if ( uneatenLength == 0 )
+      // Feed bytestreams to them
+      if ( !feedChannelsInParallel( hungryChannels, dpkt ) )
+      {
+         for ( DecodeChannel *channel : hungryChannels )
          {
-            channel.dump( 8 );
+            _feedChannel( *channel, dpkt );
          }
+      }
 
-         std::cout << "  stream[" << channel.bytestreamNumber << "]: bytesProcessed=" << bytesProcessed << std::endl;
-#endif
-
-         // Adjust counts of bytestream location
-         channel.currentBytestreamBufferIndex += bytesProcessed;
+      bool anyChannelHasExhaustedPacket = false;
+      uint64_t nextPacketLogicalOffset = E57_UINT64_MAX;
 
+      for ( const DecodeChannel *channel : hungryChannels )
+      {
          // Check if this channel has exhausted its bytestream buffer in this
          // packet
-         if ( channel.isInputBlocked() )
+         if ( channel->isInputBlocked() )
          {
 #ifdef E57_MAX_VERBOSE
-            std::cout << "  stream[" << channel.bytestreamNumber << "] has exhausted its input in current packet"
+            std::cout << "  stream[" << channel->bytestreamNumber << "] has exhausted its input in current packet"
                       << std::endl;
 #endif
             anyChannelHasExhaustedPacket = true;
@@ -477,6 +725,64 @@ namespace e57
       }
    }
 
+   bool CompressedVectorReaderImpl::feedChannelsInParallel( const std::vector<DecodeChannel *> &channels,
+                                                            DataPacket *dpkt )
+   {
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      /// Readers decoding part of a parallel read() are already running on the decoding threads
+      if ( ( imf->decodeThreadCount_ < 2 ) || workerCache_ || ( channels.size() < 2 ) )
+      {
+         return false;
+      }
+
+      std::vector<size_t> lengths;
+      lengths.reserve( channels.size() );
+
+      size_t totalLength = 0;
+
+      for ( const DecodeChannel *channel : channels )
+      {
+         lengths.push_back( _uneatenLength( *channel ) );
+         totalLength += lengths.back();
+      }
+
+      if ( totalLength < cMinParallelFeedLength )
+      {
+         return false;
+      }
+
+      /// Share the channels out between the tasks so each has about the same number of bytes to decode
+      const std::vector<std::vector<DecodeChannel *>> taskChannels =
+         shareOutWork( channels, lengths, imf->decodeThreadCount_ );
+
+      const size_t taskCount = taskChannels.size();
+
+      TaskGroup tasks( imf->decodeExecutor() );
+
+      for ( size_t i = 1; i < taskCount; ++i )
+      {
+         const std::vector<DecodeChannel *> *feedChannels = &taskChannels[i];
+
+         tasks.run( [feedChannels, dpkt] {
+            for ( DecodeChannel *channel : *feedChannels )
+            {
+               _feedChannel( *channel, dpkt );
+            }
+         } );
+      }
+
+      /// Do the first share here while the others are running
+      for ( DecodeChannel *channel : taskChannels[0] )
+      {
+         _feedChannel( *channel, dpkt );
+      }
+
+      tasks.wait();
+
+      return true;
+   }
+
    uint64_t CompressedVectorReaderImpl::findNextDataPacket( uint64_t nextPacketLogicalOffset )
    {
 #ifdef E57_MAX_VERBOSE
@@ -490,7 +796,7 @@ namespace e57
       {
          char *anyPacket = nullptr;
 
-         std::unique_ptr<PacketLock> packetLock = cache_->lock( nextPacketLogicalOffset, anyPacket );
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( nextPacketLogicalOffset, anyPacket, readAhead_.get() );
 
          /// Guess it's a data packet, if not continue to next packet
          auto dpkt = reinterpret_cast<const DataPacket *>( anyPacket );
@@ -512,12 +818,289 @@ namespace e57
       return E57_UINT64_MAX;
    }
 
-   void CompressedVectorReaderImpl::seek( uint64_t /*recordNumber*/ )
+   void CompressedVectorReaderImpl::seek( uint64_t recordNumber )
    {
+#ifdef E57_MAX_VERBOSE
+      std::cout << "CompressedVectorReaderImpl::seek() called, recordNumber=" << recordNumber << std::endl;
+#endif
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+      checkReaderOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
+
+      if ( recordNumber > maxRecordCount_ )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_API_ARGUMENT, "recordNumber=" + toString( recordNumber ) +
+                                                              " maxRecordCount=" + toString( maxRecordCount_ ) );
+      }
+
+      nextRecordNumber_ = recordNumber;
+
+      /// Seeking to the end leaves nothing to read
+      if ( recordNumber == maxRecordCount_ )
+      {
+         for ( DecodeChannel &channel : channels_ )
+         {
+            channel.decoder->stateReset( recordNumber, 0 );
+            channel.inputFinished = true;
+         }
+
+         return;
+      }
+
+      /// Find the closest chunk that starts at or before the record. Without index packets the only one we know
+      /// about is the first data packet, but we can use a packet index built by scanning the packet headers.
+      uint64_t chunkRecordNumber = 0;
+      uint64_t chunkLogicalOffset = dataLogicalOffset_;
+      const PacketIndex *packetIndex = nullptr;
+
+      if ( indexLogicalOffset_ != 0 )
+      {
+         findChunk( recordNumber, chunkRecordNumber, chunkLogicalOffset );
+      }
+      else
+      {
+         ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+         packetIndex = imf->packetIndex( cVector_->getBinarySectionLogicalStart(), dataLogicalOffset_,
+                                         sectionEndLogicalOffset_ );
+      }
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "  chunkRecordNumber=" << chunkRecordNumber << " chunkLogicalOffset=" << chunkLogicalOffset
+                << std::endl;
+#endif
+
+      /// Work out where in its bytestream each channel should start. Records of a fixed size can be found without
+      /// decoding, but the decoders need to start on a word boundary, so start at the last record before the one we
+      /// want which begins on a 64 bit boundary & let the decoder skip the rest. Anything else is decoded from the
+      /// start of the chunk.
+      std::vector<uint64_t> byteOffsets( channels_.size(), 0 );
+
+      for ( size_t i = 0; i < channels_.size(); ++i )
+      {
+         DecodeChannel &channel = channels_[i];
+
+         uint64_t startRecordNumber = chunkRecordNumber;
+
+         const unsigned bitsPerRecord = channel.decoder->bitsPerRecord();
+
+         if ( bitsPerRecord > 0 )
+         {
+            /// Number of records between 64 bit boundaries
+            unsigned alignedRecordCount = 64;
+            while ( ( alignedRecordCount > 1 ) && ( ( alignedRecordCount / 2 ) * bitsPerRecord ) % 64 == 0 )
+            {
+               alignedRecordCount /= 2;
+            }
+
+            startRecordNumber += ( recordNumber - chunkRecordNumber ) / alignedRecordCount * alignedRecordCount;
+
+            byteOffsets[i] = ( startRecordNumber - chunkRecordNumber ) * bitsPerRecord / 8;
+         }
+
+         channel.decoder->stateReset( startRecordNumber, recordNumber - startRecordNumber );
+         channel.inputFinished = false;
+      }
+
+      /// The packet index knows where every byte of each bytestream is
+      if ( packetIndex != nullptr )
+      {
+         for ( size_t i = 0; i < channels_.size(); ++i )
+         {
+            DecodeChannel &channel = channels_[i];
+
+            uint64_t byteOffset = byteOffsets[i];
+            size_t bufferLength = 0;
+
+            channel.currentPacketLogicalOffset = packetIndex->findPacket( channel.bytestreamNumber, byteOffset,
+                                                                          bufferLength );
+            channel.currentBytestreamBufferIndex = static_cast<size_t>( byteOffset );
+            channel.currentBytestreamBufferLength = bufferLength;
+         }
+
+         return;
+      }
+
+      /// Walk the data packets from the chunk until we find each channel's starting byte. This only looks at the
+      /// packet headers, and it is usually only one packet since the index packets point to every chunk.
+      std::vector<bool> positioned( channels_.size(), false );
+      size_t positionedCount = 0;
+
+      uint64_t packetLogicalOffset = chunkLogicalOffset;
+
+      while ( positionedCount < channels_.size() )
+      {
+         packetLogicalOffset = findNextDataPacket( packetLogicalOffset );
+
+         if ( packetLogicalOffset == E57_UINT64_MAX )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "recordNumber=" + toString( recordNumber ) +
+                                                              " chunkRecordNumber=" + toString( chunkRecordNumber ) );
+         }
+
+         auto dpkt = dataPacket( packetLogicalOffset );
+
+         for ( size_t i = 0; i < channels_.size(); ++i )
+         {
+            if ( positioned[i] )
+            {
+               continue;
+            }
+
+            DecodeChannel &channel = channels_[i];
+
+            const size_t bufferLength = dpkt->getBytestreamBufferLength( channel.bytestreamNumber );
+
+            /// Channels starting at the beginning of their bytestream in this packet don't care if it's empty
+            if ( ( byteOffsets[i] == 0 ) || ( byteOffsets[i] < bufferLength ) )
+            {
+               channel.currentPacketLogicalOffset = packetLogicalOffset;
+               channel.currentBytestreamBufferIndex = static_cast<size_t>( byteOffsets[i] );
+               channel.currentBytestreamBufferLength = bufferLength;
+
+               positioned[i] = true;
+               ++positionedCount;
+            }
+            else
+            {
+               byteOffsets[i] -= bufferLength;
+            }
+         }
+
+         packetLogicalOffset += dpkt->header.packetLogicalLengthMinus1 + 1;
+      }
+   }
+
+   void CompressedVectorReaderImpl::findChunk( uint64_t recordNumber, uint64_t &chunkRecordNumber,
+                                               uint64_t &chunkLogicalOffset )
+   {
+      /// Once a parallel read() has loaded all the chunks there's no need to walk the index packets
+      if ( !chunkRecordNumbers_.empty() )
+      {
+         const auto found = std::upper_bound( chunkRecordNumbers_.begin(), chunkRecordNumbers_.end(), recordNumber );
+
+         if ( found == chunkRecordNumbers_.begin() )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "recordNumber=" + toString( recordNumber ) +
+                                                              " chunkRecordNumber=" + toString( *found ) );
+         }
+
+         const auto chunk = static_cast<size_t>( std::distance( chunkRecordNumbers_.begin(), found ) - 1 );
+
+         chunkRecordNumber = chunkRecordNumbers_[chunk];
+         chunkLogicalOffset = chunkLogicalOffsets_[chunk];
+         return;
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      uint64_t packetLogicalOffset = indexLogicalOffset_;
+      unsigned previousLevel = E57_UINT32_MAX;
+
+      /// Descend from the top index packet to level 0, which points at the data packets
+      while ( true )
+      {
+         IndexPacket::IndexPacketEntry entry;
+         unsigned level = 0;
+
+         {
+            char *anyPacket = nullptr;
+
+            std::unique_ptr<PacketLock> packetLock = cache_->lock( packetLogicalOffset, anyPacket );
+
+            auto ipkt = reinterpret_cast<const IndexPacket *>( anyPacket );
+
+            if ( ipkt->packetType != INDEX_PACKET )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetType=" + toString( ipkt->packetType ) );
+            }
+
+            level = ipkt->indexLevel;
+
+            /// Each level must be below the one pointing to it, or we could go round in circles
+            if ( ( level >= previousLevel ) || ( ipkt->entryCount == 0 ) )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "indexLevel=" + toString( level ) +
+                                                                 " entryCount=" + toString( ipkt->entryCount ) );
+            }
+
+            /// Find the last entry starting at or before the record
+            const IndexPacket::IndexPacketEntry *first = ipkt->entries;
+            const IndexPacket::IndexPacketEntry *last = first + ipkt->entryCount;
+
+            auto found = std::upper_bound(
+               first, last, recordNumber,
+               []( uint64_t record, const IndexPacket::IndexPacketEntry &e ) { return record < e.chunkRecordNumber; } );
+
+            if ( found == first )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET,
+                                     "recordNumber=" + toString( recordNumber ) +
+                                        " chunkRecordNumber=" + toString( first->chunkRecordNumber ) );
+            }
+
+            entry = *( found - 1 );
+         }
+
+         const uint64_t entryLogicalOffset = imf->file_->physicalToLogical( entry.chunkPhysicalOffset );
+
+         if ( level == 0 )
+         {
+            chunkRecordNumber = entry.chunkRecordNumber;
+            chunkLogicalOffset = entryLogicalOffset;
+            return;
+         }
 
-      ///!!! implement
-      throw E57_EXCEPTION1( E57_ERROR_NOT_IMPLEMENTED );
+         packetLogicalOffset = entryLogicalOffset;
+         previousLevel = level;
+      }
+   }
+
+   void CompressedVectorReaderImpl::loadChunks( uint64_t indexPacketLogicalOffset, unsigned parentLevel )
+   {
+      std::vector<IndexPacket::IndexPacketEntry> entries;
+      unsigned level = 0;
+
+      {
+         char *anyPacket = nullptr;
+
+         std::unique_ptr<PacketLock> packetLock = cache_->lock( indexPacketLogicalOffset, anyPacket );
+
+         auto ipkt = reinterpret_cast<const IndexPacket *>( anyPacket );
+
+         if ( ipkt->packetType != INDEX_PACKET )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetType=" + toString( ipkt->packetType ) );
+         }
+
+         level = ipkt->indexLevel;
+
+         /// Each level must be below the one pointing to it, or we could go round in circles
+         if ( ( level >= parentLevel ) || ( ipkt->entryCount == 0 ) )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET,
+                                  "indexLevel=" + toString( level ) + " entryCount=" + toString( ipkt->entryCount ) );
+         }
+
+         /// Only one packet can be locked at a time, so copy the entries out before going down a level
+         entries.assign( ipkt->entries, ipkt->entries + ipkt->entryCount );
+      }
+
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      for ( const auto &entry : entries )
+      {
+         const uint64_t entryLogicalOffset = imf->file_->physicalToLogical( entry.chunkPhysicalOffset );
+
+         if ( level == 0 )
+         {
+            chunkRecordNumbers_.push_back( entry.chunkRecordNumber );
+            chunkLogicalOffsets_.push_back( entryLogicalOffset );
+         }
+         else
+         {
+            loadChunks( entryLogicalOffset, level );
+         }
+      }
    }
 
    bool CompressedVectorReaderImpl::isOpen() const
@@ -534,9 +1117,13 @@ namespace e57
 
    void CompressedVectorReaderImpl::close()
    {
-      /// Before anything that can throw, decrement reader count
+      /// Before anything that can throw, decrement reader count. Workers weren't counted.
       ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
-      imf->decrReaderCount();
+
+      if ( !workerCache_ )
+      {
+         imf->decrReaderCount();
+      }
 
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
 
@@ -546,12 +1133,20 @@ namespace e57
          return;
       }
 
-      /// Destroy decoders
+      /// Destroy workers & decoders
+      workers_.clear();
       channels_.clear();
 
-      delete cache_;
+      /// Stop reading ahead before we let go of the cache
+      readAhead_.reset();
+
+      /// Let another reader have the ImageFile's cache
+      imf->releasePacketCache( cache_ );
       cache_ = nullptr;
 
+      ownCache_.reset();
+      workerCache_.reset();
+
       isOpen_ = false;
    }
 
@@ -598,6 +1193,9 @@ namespace e57
       os << space( indent ) << "recordCount:             " << recordCount_ << std::endl;
       os << space( indent ) << "maxRecordCount:          " << maxRecordCount_ << std::endl;
       os << space( indent ) << "sectionEndLogicalOffset: " << sectionEndLogicalOffset_ << std::endl;
+      os << space( indent ) << "dataLogicalOffset:       " << dataLogicalOffset_ << std::endl;
+      os << space( indent ) << "indexLogicalOffset:      " << indexLogicalOffset_ << std::endl;
+      os << space( indent ) << "nextRecordNumber:        " << nextRecordNumber_ << std::endl;
    }
 #endif
 
@@ -31,6 +31,7 @@
 namespace e57
 {
    class DataPacket;
+   class PacketReadAhead;
    class PacketReadCache;
 
    class CompressedVectorReaderImpl
@@ -50,14 +51,24 @@ namespace e57
 #endif
 
    private:
+      /// A reader decoding part of a parallel read() for parent into slices of its buffers, on another thread
+      CompressedVectorReaderImpl( const CompressedVectorReaderImpl &parent, std::vector<SourceDestBuffer> &dbufs );
+
       void checkImageFileOpen( const char *srcFileName, int srcLineNumber, const char *srcFunctionName ) const;
       void checkReaderOpen( const char *srcFileName, int srcLineNumber, const char *srcFunctionName ) const;
       void setBuffers( std::vector<SourceDestBuffer> &dbufs ); //???needed?
+      void createChannels( std::vector<SourceDestBuffer> &dbufs );
       uint64_t earliestPacketNeededForInput() const;
 
       DataPacket *dataPacket( uint64_t inLogicalOffset ) const;
       void feedPacketToDecoders( uint64_t currentPacketLogicalOffset );
+      bool feedChannelsInParallel( const std::vector<DecodeChannel *> &channels, DataPacket *dpkt );
       uint64_t findNextDataPacket( uint64_t nextPacketLogicalOffset );
+      void findChunk( uint64_t recordNumber, uint64_t &chunkRecordNumber, uint64_t &chunkLogicalOffset );
+      void loadChunks( uint64_t indexPacketLogicalOffset, unsigned parentLevel );
+
+      bool readParallel( unsigned &outputCount );
+      void setWorkerBuffers( std::vector<SourceDestBuffer> &dbufs );
 
       //??? no default ctor, copy, assignment?
 
@@ -67,9 +78,26 @@ namespace e57
       NodeImplSharedPtr proto_;
       std::vector<DecodeChannel> channels_;
       PacketReadCache *cache_;
+      std::unique_ptr<PacketReadAhead> readAhead_; /// nullptr unless reading ahead
+
+      /// The cache of a reader opened while another reader has the ImageFile's, nullptr otherwise
+      std::unique_ptr<PacketReadCache> ownCache_;
+
+      /// Readers decoding part of a parallel read() on another thread have their own cache, since the ImageFile's
+      /// isn't thread safe. nullptr otherwise.
+      std::unique_ptr<PacketReadCache> workerCache_;
 
       uint64_t recordCount_; /// number of records written so far
       uint64_t maxRecordCount_;
       uint64_t sectionEndLogicalOffset_;
+      uint64_t dataLogicalOffset_;  /// first data packet
+      uint64_t indexLogicalOffset_; /// top index packet, zero if the section has no index
+
+      uint64_t nextRecordNumber_;                 /// first record the next read() returns
+      std::vector<uint64_t> chunkRecordNumbers_;  /// first record of each chunk in the index, loaded when needed
+      std::vector<uint64_t> chunkLogicalOffsets_; /// first data packet of each chunk in chunkRecordNumbers_
+
+      /// Readers decoding the parts of a parallel read(), kept for the next one
+      std::vector<std::unique_ptr<CompressedVectorReaderImpl>> workers_;
    };
 }
@@ -63,6 +63,10 @@ safely and gracefully end the transfer.
 CompressedVectorWriter destructor is invoked, all writes to the
 CompressedVectorNode will be lost (it will have zero children).
 
+Several CompressedVectorWriters may be open on an ImageFile at once, each
+writing a different CompressedVectorNode, for example to write each scan of a
+file on its own thread. See CompressedVectorNode::writer.
+
 @section CompressedVectorWriter_invariant Class Invariant
 A class invariant is a list of statements about an object that are always true
 before and after any operation on the object. An invariant is useful for testing
@@ -330,8 +334,8 @@ void CompressedVectorWriter::checkInvariant( bool /*doRecurse*/ )
       throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
    }
 
-   // Dest ImageFile must have exactly 1 writer (this one)
-   if ( imf.writerCount() != 1 )
+   // Dest ImageFile must have at least 1 writer (this one)
+   if ( imf.writerCount() < 1 )
    {
       throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
    }
@@ -25,7 +25,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 #include <numeric>
 
 #include "CheckedFile.h"
@@ -35,9 +37,16 @@
 #include "SectionHeaders.h"
 #include "SourceDestBufferImpl.h"
 #include "StringFunctions.h"
+#include "ThreadPool.h"
 
 namespace e57
 {
+   /// Number of packets which may be waiting for the background thread before write() blocks
+   constexpr unsigned cWriteQueuePacketCount = 4;
+
+   /// Producing fewer bytes than this for a packet isn't worth sharing out between threads
+   constexpr size_t cMinParallelEncodeLength = 16 * 1024;
+
    struct SortByBytestreamNumber
    {
       bool operator()( const std::shared_ptr<Encoder> &lhs, const std::shared_ptr<Encoder> &rhs ) const
@@ -109,11 +118,7 @@ namespace e57
 
       ImageFileImplSharedPtr imf( ni->destImageFile_ );
 
-      /// Reserve space for CompressedVector binary section header, record location
-      /// so can save to when writer closes. Request that file be extended with
-      /// zeros since we will write to it at a later time (when writer closes).
-      sectionHeaderLogicalStart_ = imf->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
-
+      sectionHeaderLogicalStart_ = 0;
       sectionLogicalLength_ = 0;
       dataPhysicalOffset_ = 0;
       topIndexPhysicalOffset_ = 0;
@@ -121,9 +126,44 @@ namespace e57
       dataPacketsCount_ = 0;
       indexPacketsCount_ = 0;
 
+      /// The first data packet starts the first chunk
+      chunkPending_ = true;
+      pendingChunkRecordNumber_ = 0;
+
+      chunkRecordCount_ = imf->chunkRecordCount_;
+      chunkEndRecordNumber_ = chunkRecordCount_;
+
+      /// Binary sections must be contiguous, so if another writer is appending to the file keep our data packets
+      /// to one side until we close
+      if ( !imf->acquireTail() )
+      {
+         spill_ = std::make_shared<PacketSpill>();
+      }
+      else
+      {
+         try
+         {
+            /// Reserve space for CompressedVector binary section header, record location
+            /// so can save to when writer closes. Request that file be extended with
+            /// zeros since we will write to it at a later time (when writer closes).
+            sectionHeaderLogicalStart_ = imf->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+
+            if ( imf->backgroundWrite_ )
+            {
+               writeQueue_.reset( new PacketWriteQueue( imf->file_, cWriteQueuePacketCount ) );
+            }
+         }
+         catch ( ... )
+         {
+            imf->releaseTail();
+            throw;
+         }
+      }
+
       /// Just before return (and can't throw) increment writer count  ??? safer
       /// way to assure don't miss close?
       imf->incrWriterCount();
+      cVector_->setWriterOpen( true );
 
       /// If get here, the writer is open
       isOpen_ = true;
@@ -155,8 +195,26 @@ namespace e57
 #endif
       ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
 
-      /// Before anything that can throw, decrement writer count
+      /// However this ends we are no longer a writer, but don't say so until our section is in the file (or queued
+      /// to be), so nobody starts reading it before then.
+      try
+      {
+         closeSection();
+      }
+      catch ( ... )
+      {
+         cVector_->setWriterOpen( false );
+         imf->decrWriterCount();
+         throw;
+      }
+
+      cVector_->setWriterOpen( false );
       imf->decrWriterCount();
+   }
+
+   void CompressedVectorWriterImpl::closeSection()
+   {
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
 
       checkImageFileOpen( __FILE__, __LINE__, static_cast<const char *>( __FUNCTION__ ) );
       /// don't call checkWriterOpen();
@@ -170,6 +228,62 @@ namespace e57
       /// try to close again.
       isOpen_ = false;
 
+      if ( spill_ )
+      {
+         writeRemainingPackets();
+         appendSpill();
+      }
+      else
+      {
+         try
+         {
+            writeRemainingPackets();
+
+            /// Wait for the background writes to finish (this reports any errors)
+            if ( writeQueue_ )
+            {
+               std::unique_ptr<PacketWriteQueue> writeQueue( std::move( writeQueue_ ) );
+
+               writeQueue->flush();
+            }
+
+            /// Index the chunks. A single chunk starts at dataPhysicalOffset_, so there is nothing to gain from an
+            /// index.
+            if ( chunkEntries_.size() > 1 )
+            {
+               topIndexPhysicalOffset_ = writeIndexPackets( imf.get(), chunkEntries_, indexPacketsCount_ );
+            }
+
+            sectionLogicalLength_ = writeSectionHeader( imf.get(), sectionHeaderLogicalStart_, dataPhysicalOffset_,
+                                                        topIndexPhysicalOffset_ );
+
+            /// Set address of associated CompressedVector
+            cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
+         }
+         catch ( ... )
+         {
+            imf->releaseTail();
+            throw;
+         }
+
+         /// Let the next writer append. This adds the sections of any which closed while we were appending.
+         imf->releaseTail();
+      }
+
+      /// Set size of associated CompressedVector
+      cVector_->setRecordCount( recordCount_ );
+
+      /// Free channels
+      bytestreams_.clear();
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "  CompressedVectorWriter:" << std::endl;
+      dump( 4 );
+#endif
+   }
+
+   void CompressedVectorWriterImpl::writeRemainingPackets()
+   {
       /// If have any data, write packet
       /// Write all remaining ioBuffers and internal encoder register cache into
       /// file. Know we are done when totalOutputAvailable() returns 0 after a
@@ -180,20 +294,66 @@ namespace e57
          packetWrite();
          flush();
       }
+   }
 
+   void CompressedVectorWriterImpl::appendSpill()
+   {
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      /// The section may be appended by another writer after we have gone, so take everything needed with it.
+      /// The spilled offsets are relative to the start of the data packets until we know where they go.
+      ImageFileImpl *file = imf.get();
+      std::shared_ptr<PacketSpill> spill( std::move( spill_ ) );
+      std::shared_ptr<CompressedVectorNodeImpl> cVector( cVector_ );
+      std::vector<IndexPacket::IndexPacketEntry> chunkEntries( chunkEntries_ );
+      const uint64_t dataSpillOffset = dataPhysicalOffset_;
+      const bool haveData = ( dataPacketsCount_ > 0 );
+
+      imf->appendSection( [file, spill, cVector, chunkEntries, dataSpillOffset, haveData]() mutable {
+         const uint64_t sectionHeaderLogicalStart =
+            file->allocateSpace( sizeof( CompressedVectorSectionHeader ), true );
+         const uint64_t dataLogicalOffset = file->allocateSpace( spill->length(), false );
+
+         spill->copyTo( file->file_, dataLogicalOffset );
+
+         for ( auto &entry : chunkEntries )
+         {
+            entry.chunkPhysicalOffset = file->file_->logicalToPhysical( dataLogicalOffset + entry.chunkPhysicalOffset );
+         }
+
+         const uint64_t dataPhysicalOffset =
+            haveData ? file->file_->logicalToPhysical( dataLogicalOffset + dataSpillOffset ) : 0;
+
+         uint64_t indexPacketsCount = 0;
+         uint64_t topIndexPhysicalOffset = 0;
+
+         if ( chunkEntries.size() > 1 )
+         {
+            topIndexPhysicalOffset = writeIndexPackets( file, chunkEntries, indexPacketsCount );
+         }
+
+         writeSectionHeader( file, sectionHeaderLogicalStart, dataPhysicalOffset, topIndexPhysicalOffset );
+
+         cVector->setBinarySectionLogicalStart( sectionHeaderLogicalStart );
+      } );
+   }
+
+   uint64_t CompressedVectorWriterImpl::writeSectionHeader( ImageFileImpl *imf, uint64_t sectionHeaderLogicalStart,
+                                                            uint64_t dataPhysicalOffset,
+                                                            uint64_t indexPhysicalOffset )
+   {
       /// Compute length of whole section we just wrote (from section start to
       /// current start of free space).
-      sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
+      const uint64_t sectionLogicalLength = imf->unusedLogicalStart_ - sectionHeaderLogicalStart;
 #ifdef E57_MAX_VERBOSE
-      std::cout << "  sectionLogicalLength_=" << sectionLogicalLength_ << std::endl; //???
+      std::cout << "  sectionLogicalLength=" << sectionLogicalLength << std::endl; //???
 #endif
 
       /// Prepare CompressedVectorSectionHeader
       CompressedVectorSectionHeader header;
-      header.sectionLogicalLength = sectionLogicalLength_;
-      header.dataPhysicalOffset = dataPhysicalOffset_;      ///??? can be zero, if no data written ???not set yet
-      header.indexPhysicalOffset = topIndexPhysicalOffset_; ///??? can be zero, if no data written ???not set
-                                                            /// yet
+      header.sectionLogicalLength = sectionLogicalLength;
+      header.dataPhysicalOffset = dataPhysicalOffset;   ///??? can be zero, if no data written ???not set yet
+      header.indexPhysicalOffset = indexPhysicalOffset; /// zero if there is no index
 #ifdef E57_MAX_VERBOSE
       std::cout << "  CompressedVectorSectionHeader:" << std::endl;
       header.dump( 4 ); //???
@@ -204,20 +364,9 @@ namespace e57
 #endif
 
       /// Write header at beginning of section, previously allocated
-      imf->file_->seek( sectionHeaderLogicalStart_ );
-      imf->file_->write( reinterpret_cast<char *>( &header ), sizeof( header ) );
-
-      /// Set address and size of associated CompressedVector
-      cVector_->setRecordCount( recordCount_ );
-      cVector_->setBinarySectionLogicalStart( sectionHeaderLogicalStart_ );
-
-      /// Free channels
-      bytestreams_.clear();
+      imf->file_->writeAt( sectionHeaderLogicalStart, reinterpret_cast<char *>( &header ), sizeof( header ) );
 
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  CompressedVectorWriter:" << std::endl;
-      dump( 4 );
-#endif
+      return sectionLogicalLength;
    }
 
    bool CompressedVectorWriterImpl::isOpen() const
@@ -296,84 +445,72 @@ namespace e57
          sbuf.impl()->rewind();
       }
 
+#ifdef E57_WRITE_CRAZY_PACKET_MODE
+      ///??? depends on number of streams
+      constexpr size_t E57_TARGET_PACKET_SIZE = 500;
+#else
+      constexpr size_t E57_TARGET_PACKET_SIZE = ( DATA_PACKET_MAX * 3 / 4 );
+#endif
+
       /// Loop until all channels have completed requestedRecordCount transfers
-      uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
+      const uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
       while ( true )
       {
-         /// Calc remaining record counts for all channels
-         uint64_t totalRecordCount = 0;
+         /// Find the channel furthest behind, we are done when it has caught up
+         uint64_t minRecordIndex = endRecordIndex;
          for ( auto &bytestream : bytestreams_ )
          {
-            totalRecordCount += endRecordIndex - bytestream->currentRecordIndex();
+            minRecordIndex = std::min( minRecordIndex, bytestream->currentRecordIndex() );
          }
 #ifdef E57_MAX_VERBOSE
-         std::cout << "  totalRecordCount=" << totalRecordCount << std::endl; //???
+         std::cout << "  minRecordIndex=" << minRecordIndex << " endRecordIndex=" << endRecordIndex
+                   << std::endl; //???
 #endif
 
-         /// We are done if have no more work, break out of loop
-         if ( totalRecordCount == 0 )
+         if ( minRecordIndex == endRecordIndex )
          {
             break;
          }
 
-         /// Estimate how many records can write before have enough data to fill
-         /// data packet to efficient length Efficient packet length is >= 75%
-         /// of maximum packet length. It is OK if get too much data (more than
-         /// one packet) in an iteration. Reader will be able to handle packets
-         /// whose streams are not exactly synchronized to the record
-         /// boundaries. But try to do a good job of keeping the stream
-         /// synchronization "close enough" (so a reader that can cache only two
-         /// packets is efficient).
+         /// In record-aligned mode, once every bytestream has reached the end of the chunk write out everything
+         /// (the registers are empty since chunks are a multiple of 64 records) so the next packet starts a chunk.
+         if ( ( chunkRecordCount_ > 0 ) && ( endRecordIndex > chunkEndRecordNumber_ ) && allAtChunkEnd() )
+         {
+            while ( totalOutputAvailable() > 0 )
+            {
+               packetWrite();
+            }
+
+            chunkEndRecordNumber_ += chunkRecordCount_;
+         }
 
+         /// Efficient packet length is >= 75% of maximum packet length. If have more than that, send it now. It is
+         /// OK if get too much data (more than one packet), packetWrite() sends a proportional part of each
+         /// bytestream & we go around again.
+         const size_t packetSize = currentPacketSize();
 #ifdef E57_MAX_VERBOSE
-         std::cout << "  currentPacketSize()=" << currentPacketSize() << std::endl; //???
-#endif
-
-#ifdef E57_WRITE_CRAZY_PACKET_MODE
-         ///??? depends on number of streams
-         constexpr size_t E57_TARGET_PACKET_SIZE = 500;
-#else
-         constexpr size_t E57_TARGET_PACKET_SIZE = ( DATA_PACKET_MAX * 3 / 4 );
+         std::cout << "  currentPacketSize()=" << packetSize << std::endl; //???
 #endif
-         /// If have more than target fraction of packet, send it now
-         if ( currentPacketSize() >= E57_TARGET_PACKET_SIZE )
-         { //???
+         if ( packetSize >= E57_TARGET_PACKET_SIZE )
+         {
             packetWrite();
-            continue; /// restart loop so recalc statistics (packet size may not be
-                      /// zero after write, if have too much data)
+            continue;
          }
 
-#ifdef E57_MAX_VERBOSE
-         ///??? useful?
-         /// Get approximation of number of bytes per record of CompressedVector
-         /// and total of bytes used
-         float totalBitsPerRecord = 0; // an estimate of future performance
-         for ( auto &bytestream : bytestreams_ )
+         /// If everything before this point has been written, the next packet can start a new chunk
+         if ( !chunkPending_ )
          {
-            totalBitsPerRecord += bytestream->bitsPerRecord();
+            chunkPending_ = atChunkBoundary( pendingChunkRecordNumber_ );
          }
 
-         const float totalBytesPerRecord = std::max( totalBitsPerRecord / 8, 0.1F ); //??? trust
-
-         std::cout << "  totalBytesPerRecord=" << totalBytesPerRecord << std::endl; //???
-#endif
-
-         /// Don't allow straggler to get too far behind. ???
-         /// Don't allow a single channel to get too far ahead ???
-         /// Process channels that are furthest behind first. ???
+         /// Encode enough records to fill the rest of the packet in one call per channel instead of a few records
+         /// at a time. Every channel stops at the same record, which keeps the streams synchronized "close enough"
+         /// that a reader caching only a couple of packets is efficient. The estimate is exact for numbers, and
+         /// the encoders stop early if their output buffers fill up.
+         const uint64_t blockEnd = blockEndRecordIndex( minRecordIndex, endRecordIndex,
+                                                        E57_TARGET_PACKET_SIZE - packetSize );
 
-         ///!!!! For now just process one record per loop until packet is full
-         /// enough, or completed request
-         for ( auto &bytestream : bytestreams_ )
-         {
-            if ( bytestream->currentRecordIndex() < endRecordIndex )
-            {
-               //!!! For now, process up to 50 records at a time
-               uint64_t recordCount = endRecordIndex - bytestream->currentRecordIndex();
-               recordCount = ( recordCount < 50ULL ) ? recordCount : 50ULL; // min(recordCount, 50ULL);
-               bytestream->processRecords( static_cast<unsigned>( recordCount ) );
-            }
-         }
+         encodeBytestreams( blockEnd );
       }
 
       recordCount_ += requestedRecordCount;
@@ -400,6 +537,136 @@ namespace e57
       return ( sizeof( DataPacketHeader ) + bytestreams_.size() * sizeof( uint16_t ) + totalOutputAvailable() );
    }
 
+   /// Estimate how many bytes an encoder will produce to reach blockEnd
+   inline size_t _pendingLength( Encoder &encoder, uint64_t blockEnd )
+   {
+      return static_cast<size_t>( ( blockEnd - encoder.currentRecordIndex() ) * encoder.bitsPerRecord() / 8 );
+   }
+
+   /// Encode records until blockEnd, or until the encoder's output buffer is full.
+   /// Only touches the encoder & its source buffer, so encoders may be run on different threads.
+   void _encodeTo( Encoder &encoder, uint64_t blockEnd )
+   {
+      const uint64_t currentRecordIndex = encoder.currentRecordIndex();
+
+      if ( blockEnd > currentRecordIndex )
+      {
+         encoder.processRecords( static_cast<size_t>( blockEnd - currentRecordIndex ) );
+      }
+   }
+
+   void CompressedVectorWriterImpl::encodeBytestreams( uint64_t blockEnd )
+   {
+      std::vector<Encoder *> encoders;
+      encoders.reserve( bytestreams_.size() );
+
+      for ( auto &bytestream : bytestreams_ )
+      {
+         if ( bytestream->currentRecordIndex() < blockEnd )
+         {
+            encoders.push_back( bytestream.get() );
+         }
+      }
+
+      if ( !encodeInParallel( encoders, blockEnd ) )
+      {
+         for ( Encoder *encoder : encoders )
+         {
+            _encodeTo( *encoder, blockEnd );
+         }
+      }
+   }
+
+   bool CompressedVectorWriterImpl::encodeInParallel( const std::vector<Encoder *> &encoders, uint64_t blockEnd )
+   {
+      ImageFileImplSharedPtr imf( cVector_->destImageFile_ );
+
+      if ( ( imf->encodeThreadCount_ < 2 ) || ( encoders.size() < 2 ) )
+      {
+         return false;
+      }
+
+      std::vector<size_t> lengths;
+      lengths.reserve( encoders.size() );
+
+      size_t totalLength = 0;
+
+      for ( Encoder *encoder : encoders )
+      {
+         lengths.push_back( _pendingLength( *encoder, blockEnd ) );
+         totalLength += lengths.back();
+      }
+
+      if ( totalLength < cMinParallelEncodeLength )
+      {
+         return false;
+      }
+
+      /// Each encoder produces its own bytestream, so the packet is the same whichever thread they run on
+      const std::vector<std::vector<Encoder *>> taskEncoders =
+         shareOutWork( encoders, lengths, imf->encodeThreadCount_ );
+
+      const size_t taskCount = taskEncoders.size();
+
+      TaskGroup tasks( imf->encodeExecutor() );
+
+      for ( size_t i = 1; i < taskCount; ++i )
+      {
+         const std::vector<Encoder *> *runEncoders = &taskEncoders[i];
+
+         tasks.run( [runEncoders, blockEnd] {
+            for ( Encoder *encoder : *runEncoders )
+            {
+               _encodeTo( *encoder, blockEnd );
+            }
+         } );
+      }
+
+      /// Do the first share here while the others are running
+      for ( Encoder *encoder : taskEncoders[0] )
+      {
+         _encodeTo( *encoder, blockEnd );
+      }
+
+      tasks.wait();
+
+      return true;
+   }
+
+   uint64_t CompressedVectorWriterImpl::blockEndRecordIndex( uint64_t startRecordIndex, uint64_t endRecordIndex,
+                                                             size_t byteCount ) const
+   {
+      /// Estimate how many records it takes to produce byteCount bytes of output
+      float totalBitsPerRecord = 0;
+      for ( auto &bytestream : bytestreams_ )
+      {
+         totalBitsPerRecord += bytestream->bitsPerRecord();
+      }
+
+      uint64_t blockRecordCount = endRecordIndex - startRecordIndex;
+      if ( totalBitsPerRecord > 0 )
+      {
+         blockRecordCount =
+            std::min( blockRecordCount, static_cast<uint64_t>( 8 * byteCount / totalBitsPerRecord ) + 1 );
+      }
+#ifdef E57_MAX_VERBOSE
+      std::cout << "  totalBitsPerRecord=" << totalBitsPerRecord << " blockRecordCount=" << blockRecordCount
+                << std::endl; //???
+#endif
+
+      /// Stop at a multiple of 64 records. Any number of bits times 64 is a whole number of words, so stopping there
+      /// leaves the registers of the bitpacked bytestreams empty, which lets a chunk start at the next packet.
+      uint64_t blockEnd = std::min( endRecordIndex, ( ( startRecordIndex + blockRecordCount + 63 ) / 64 ) * 64 );
+
+      /// In record-aligned mode, wait at the end of the chunk for the other bytestreams
+      if ( chunkRecordCount_ > 0 )
+      {
+         blockEnd = std::min( blockEnd, chunkEndRecordNumber_ );
+      }
+
+      return blockEnd;
+   }
+
    uint64_t CompressedVectorWriterImpl::packetWrite()
    {
 #ifdef E57_MAX_VERBOSE
@@ -560,12 +827,27 @@ namespace e57
       /// Double check that data packet is well formed
       dataPacket_.verify( packetLength );
 
-      /// Write whole data packet at beginning of free space in file
-      uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
-      uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
-      imf->file_->seek( packetLogicalOffset ); //??? have seekLogical and seekPhysical instead?
-                                               // more explicit
-      imf->file_->write( packet, packetLength );
+      /// Write whole data packet at beginning of free space in file. Spilled packets are only given their offset in
+      /// the spill, until appendSpill() knows where they go.
+      uint64_t packetPhysicalOffset = 0;
+      if ( spill_ )
+      {
+         packetPhysicalOffset = spill_->write( packet, packetLength );
+      }
+      else
+      {
+         const uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
+         packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
+
+         if ( writeQueue_ )
+         {
+            writeQueue_->write( packetLogicalOffset, packet, packetLength );
+         }
+         else
+         {
+            imf->file_->writeAt( packetLogicalOffset, packet, packetLength );
+         }
+      }
 
 #ifdef E57_MAX_VERBOSE
 //  std::cout << "data packet:" << std::endl;
@@ -584,12 +866,132 @@ namespace e57
       }
       dataPacketsCount_++;
 
-      ///!!! update seekIndex here? if started new chunk?
+      if ( chunkPending_ )
+      {
+         IndexPacket::IndexPacketEntry entry;
+         entry.chunkRecordNumber = pendingChunkRecordNumber_;
+         entry.chunkPhysicalOffset = packetPhysicalOffset;
+
+         chunkEntries_.push_back( entry );
+
+         chunkPending_ = false;
+      }
 
       /// Return physical offset of data packet for potential use in seekIndex
       return ( packetPhysicalOffset ); //??? needed
    }
 
+   bool CompressedVectorWriterImpl::atChunkBoundary( uint64_t &recordNumber )
+   {
+      /// Everything must have been written out of the bytestreams...
+      if ( totalOutputAvailable() > 0 )
+      {
+         return false;
+      }
+
+      /// ...they must all be at the same record...
+      const uint64_t firstRecordIndex = bytestreams_.at( 0 )->currentRecordIndex();
+
+      for ( auto &bytestream : bytestreams_ )
+      {
+         if ( bytestream->currentRecordIndex() != firstRecordIndex )
+         {
+            return false;
+         }
+
+         /// ...and no partial words may be held back.
+         if ( !bytestream->registerEmpty() )
+         {
+            return false;
+         }
+      }
+
+      recordNumber = firstRecordIndex;
+
+      return true;
+   }
+
+   bool CompressedVectorWriterImpl::allAtChunkEnd()
+   {
+      for ( auto &bytestream : bytestreams_ )
+      {
+         if ( bytestream->currentRecordIndex() != chunkEndRecordNumber_ )
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   uint64_t
+      CompressedVectorWriterImpl::writeIndexPackets( ImageFileImpl *imf,
+                                                     const std::vector<IndexPacket::IndexPacketEntry> &chunkEntries,
+                                                     uint64_t &indexPacketsCount )
+   {
+#ifdef E57_MAX_VERBOSE
+      std::cout << "CompressedVectorWriterImpl::writeIndexPackets() called, chunkCount=" << chunkEntries.size()
+                << std::endl;
+#endif
+      /// Level 0 packets point to data packets, each level above points to the packets of the level below, until
+      /// one packet (the top) covers everything.
+      std::vector<IndexPacket::IndexPacketEntry> entries( chunkEntries );
+      uint64_t packetPhysicalOffset = 0;
+
+      for ( uint8_t level = 0;; ++level )
+      {
+         /// Spread the entries evenly, so packets above level 0 never end up with fewer than two entries
+         const size_t packetCount = ( entries.size() + IndexPacket::MAX_ENTRIES - 1 ) / IndexPacket::MAX_ENTRIES;
+
+         std::vector<IndexPacket::IndexPacketEntry> parentEntries;
+
+         size_t first = 0;
+
+         for ( size_t i = 0; i < packetCount; ++i )
+         {
+            const size_t entryCount = ( entries.size() - first ) / ( packetCount - i );
+
+            std::unique_ptr<IndexPacket> packet( new IndexPacket );
+
+            packet->entryCount = static_cast<uint16_t>( entryCount );
+            packet->indexLevel = level;
+
+            std::copy_n( &entries[first], entryCount, packet->entries );
+
+            /// Always write the full packet. Older versions of this library refuse to read shorter index packets.
+            const unsigned packetLength = sizeof( IndexPacket );
+
+            packet->packetLogicalLengthMinus1 = static_cast<uint16_t>( packetLength - 1 );
+
+            /// Double check that index packet is well formed
+            packet->verify( packetLength );
+
+            const uint64_t packetLogicalOffset = imf->allocateSpace( packetLength, false );
+            packetPhysicalOffset = imf->file_->logicalToPhysical( packetLogicalOffset );
+
+            imf->file_->writeAt( packetLogicalOffset, reinterpret_cast<char *>( packet.get() ), packetLength );
+
+            ++indexPacketsCount;
+
+            IndexPacket::IndexPacketEntry parentEntry;
+            parentEntry.chunkRecordNumber = entries[first].chunkRecordNumber;
+            parentEntry.chunkPhysicalOffset = packetPhysicalOffset;
+
+            parentEntries.push_back( parentEntry );
+
+            first += entryCount;
+         }
+
+         if ( packetCount == 1 )
+         {
+            /// The last packet written is the top
+            return packetPhysicalOffset;
+         }
+
+         entries.swap( parentEntries );
+      }
+   }
+
    void CompressedVectorWriterImpl::flush()
    {
       for ( auto &bytestream : bytestreams_ )
@@ -656,6 +1058,7 @@ namespace e57
       os << space( indent ) << "recordCount:               " << recordCount_ << std::endl;
       os << space( indent ) << "dataPacketsCount:          " << dataPacketsCount_ << std::endl;
       os << space( indent ) << "indexPacketsCount:         " << indexPacketsCount_ << std::endl;
+      os << space( indent ) << "chunkRecordCount:          " << chunkRecordCount_ << std::endl;
    }
 #endif
 }
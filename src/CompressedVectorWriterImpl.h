@@ -52,8 +52,22 @@ namespace e57
       void setBuffers( std::vector<SourceDestBuffer> &sbufs ); //???needed?
       size_t totalOutputAvailable() const;
       size_t currentPacketSize() const;
+      uint64_t blockEndRecordIndex( uint64_t startRecordIndex, uint64_t endRecordIndex, size_t byteCount ) const;
+      void encodeBytestreams( uint64_t blockEnd );
+      bool encodeInParallel( const std::vector<Encoder *> &encoders, uint64_t blockEnd );
       uint64_t packetWrite();
       void flush();
+      bool atChunkBoundary( uint64_t &recordNumber );
+      bool allAtChunkEnd();
+      void closeSection();
+      void writeRemainingPackets();
+      void appendSpill();
+
+      static uint64_t writeIndexPackets( ImageFileImpl *imf,
+                                         const std::vector<IndexPacket::IndexPacketEntry> &chunkEntries,
+                                         uint64_t &indexPacketsCount );
+      static uint64_t writeSectionHeader( ImageFileImpl *imf, uint64_t sectionHeaderLogicalStart,
+                                          uint64_t dataPhysicalOffset, uint64_t indexPhysicalOffset );
 
       //??? no default ctor, copy, assignment?
 
@@ -64,6 +78,12 @@ namespace e57
       std::vector<std::shared_ptr<Encoder>> bytestreams_;
       DataPacket dataPacket_;
 
+      /// Only used when writing packets in the background
+      std::unique_ptr<PacketWriteQueue> writeQueue_;
+
+      /// Holds the data packets while another writer is appending to the file, nullptr if we're appending
+      std::shared_ptr<PacketSpill> spill_;
+
       bool isOpen_;
       uint64_t sectionHeaderLogicalStart_; /// start of CompressedVector binary section
       uint64_t sectionLogicalLength_;      /// total length of CompressedVector binary section
@@ -72,5 +92,16 @@ namespace e57
       uint64_t recordCount_;               /// number of records written so far
       uint64_t dataPacketsCount_;          /// number of data packets written so far
       uint64_t indexPacketsCount_;         /// number of index packets written so far
+
+      /// Record number & physical offset of the first data packet of each chunk, for the index packets.
+      /// A chunk starts with a data packet in which every bytestream starts with the same record.
+      std::vector<IndexPacket::IndexPacketEntry> chunkEntries_;
+      bool chunkPending_;                 /// next data packet starts a chunk
+      uint64_t pendingChunkRecordNumber_; /// first record of that chunk
+
+      /// Record-aligned mode (ImageFileOptions::chunkRecordCount): no bytestream goes past chunkEndRecordNumber_
+      /// until they have all reached it & been written out, which then starts a new chunk.
+      uint64_t chunkRecordCount_;    /// 0 if not record-aligned
+      uint64_t chunkEndRecordNumber_; /// end of the current chunk
    };
 }
@@ -26,8 +26,10 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 
+#include "BitPack.h"
 #include "CompressedVectorNodeImpl.h"
 #include "Decoder.h"
 #include "FloatNodeImpl.h"
@@ -39,6 +41,48 @@
 
 using namespace e57;
 
+namespace
+{
+   /// Number of values BitpackIntegerDecoder unpacks at a time before storing them
+   constexpr size_t cUnpackBlockSize = 64;
+
+   /// Store count floating point values of type T from buf, which needn't be aligned, converting them as required
+   template <typename T> void setNextReals( SourceDestBufferImpl &dbuf, const char *buf, size_t count )
+   {
+      T values[cUnpackBlockSize];
+
+      for ( size_t done = 0; done < count; )
+      {
+         const size_t blockCount = std::min( cUnpackBlockSize, count - done );
+
+         memcpy( values, buf + done * sizeof( T ), blockCount * sizeof( T ) );
+
+#ifdef E57_MAX_VERBOSE
+         for ( size_t i = 0; i < blockCount; ++i )
+         {
+            std::cout << "  got value=" << values[i] << std::endl;
+         }
+#endif
+
+         dbuf.setNextBlock( values, blockCount );
+
+         done += blockCount;
+      }
+   }
+
+   /// Whether scaled integers going to dbuf can be scaled as they're unpacked. Only floating point buffers can: they
+   /// need the same conversion as unpackScaledBits() does, and none of the results can be too big to store.
+   bool canUnpackScaled( const SourceDestBufferImpl &dbuf, double scale, double offset )
+   {
+      const MemoryRepresentation representation = dbuf.memoryRepresentation();
+
+      /// Values are at most 2^63 in magnitude
+      return dbuf.doScaling() && dbuf.doConversion() &&
+             ( ( representation == E57_REAL32 ) || ( representation == E57_REAL64 ) ) &&
+             std::isfinite( std::fabs( scale ) * 1.0e19 + std::fabs( offset ) );
+   }
+}
+
 std::shared_ptr<Decoder> Decoder::DecoderFactory( unsigned bytestreamNumber, //!!! name ok?
                                                   const CompressedVectorNodeImpl *cVector,
                                                   std::vector<SourceDestBuffer> &dbufs, const ustring & /*codecPath*/ )
@@ -215,6 +259,25 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
              << " availableByteCount=" << availableByteCount << std::endl;
 #endif
    size_t bytesUnsaved = availableByteCount;
+
+   /// With nothing staged in inBuffer_, decode straight from the caller's bytes. The decoders only read the bytes
+   /// holding whole records and don't rely on alignment, so just what's left over - the bytes straddling the end of
+   /// the packet, or those that can't be stored in destBuffer_ yet - needs to be staged.
+   if ( ( source != nullptr ) && ( bytesUnsaved > 0 ) && ( inBufferEndByte_ == 0 ) && ( skipCount_ == 0 ) )
+   {
+      const size_t bitsEaten = inputProcessAligned( source, 0, bytesUnsaved * 8 );
+
+#ifdef E57_MAX_VERBOSE
+      std::cout << "  decoded " << bitsEaten << " bits directly" << std::endl;
+#endif
+
+      source += bitsEaten / 8;
+      bytesUnsaved -= bitsEaten / 8;
+
+      /// Any partly eaten byte is staged along with the rest
+      inBufferFirstBit_ = bitsEaten % 8;
+   }
+
    size_t bitsEaten = 0;
    do
    {
@@ -248,35 +311,46 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
       }
 #endif
 
-      /// ??? fix doc for new bit interface
-      /// Now that we have input stored in an aligned buffer, call derived class
-      /// to try to eat some Note that end of filled buffer may not be at a
-      /// natural boundary. The subclass may transfer this partial word in a
-      /// full word transfer, but it must be careful to only use the defined
-      /// bits. inBuffer_ is a multiple of largest word size, so this full word
-      /// transfer off the end will always be in defined memory.
+      /// Now that the leftover input is stored in inBuffer_, call derived class
+      /// to try to eat some. Note that end of filled buffer may not be at a
+      /// natural boundary, so the subclass must be careful to only use the
+      /// defined bits.
 
-      size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
-      size_t firstNaturalBit = firstWord * bitsPerWord_;
       size_t endBit = inBufferEndByte_ * 8;
+
+      /// Records of a fixed size being skipped after a seek don't need decoding, just step over them
+      size_t bitsSkipped = 0;
+      if ( ( skipCount_ > 0 ) && ( bitsPerRecord() > 0 ) )
+      {
+         bitsSkipped = skipFixedSizeRecords( endBit );
+      }
+
+      bitsEaten = 0;
+      if ( ( skipCount_ == 0 ) || ( bitsPerRecord() == 0 ) )
+      {
+         size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
+         size_t firstNaturalBit = firstWord * bitsPerWord_;
 #ifdef E57_MAX_VERBOSE
-      std::cout << "  feeding aligned decoder " << endBit - inBufferFirstBit_ << " bits." << std::endl;
+         std::cout << "  feeding aligned decoder " << endBit - inBufferFirstBit_ << " bits." << std::endl;
 #endif
-      bitsEaten = inputProcessAligned( &inBuffer_[firstWord * bytesPerWord_], inBufferFirstBit_ - firstNaturalBit,
-                                       endBit - firstNaturalBit );
+         bitsEaten = inputProcessAligned( &inBuffer_[firstWord * bytesPerWord_], inBufferFirstBit_ - firstNaturalBit,
+                                          endBit - firstNaturalBit );
 #ifdef E57_MAX_VERBOSE
-      std::cout << "  bitsEaten=" << bitsEaten << " firstWord=" << firstWord << " firstNaturalBit=" << firstNaturalBit
-                << " endBit=" << endBit << std::endl;
+         std::cout << "  bitsEaten=" << bitsEaten << " firstWord=" << firstWord
+                   << " firstNaturalBit=" << firstNaturalBit << " endBit=" << endBit << std::endl;
 #endif
 #ifdef E57_DEBUG
-      if ( bitsEaten > endBit - inBufferFirstBit_ )
-      {
-         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "bitsEaten=" + toString( bitsEaten ) +
-                                                      " endBit=" + toString( endBit ) +
-                                                      " inBufferFirstBit=" + toString( inBufferFirstBit_ ) );
-      }
+         if ( bitsEaten > endBit - inBufferFirstBit_ )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "bitsEaten=" + toString( bitsEaten ) +
+                                                         " endBit=" + toString( endBit ) +
+                                                         " inBufferFirstBit=" + toString( inBufferFirstBit_ ) );
+         }
 #endif
-      inBufferFirstBit_ += bitsEaten;
+         inBufferFirstBit_ += bitsEaten;
+      }
+
+      bitsEaten += bitsSkipped;
 
       /// Shift uneaten data to beginning of inBuffer_, keep on natural word
       /// boundaries.
@@ -290,10 +364,30 @@ size_t BitpackDecoder::inputProcess( const char *source, const size_t availableB
    return ( availableByteCount - bytesUnsaved );
 }
 
-void BitpackDecoder::stateReset()
+void BitpackDecoder::stateReset( uint64_t recordIndex, uint64_t skipCount )
 {
    inBufferFirstBit_ = 0;
    inBufferEndByte_ = 0;
+
+   currentRecordIndex_ = recordIndex;
+   skipCount_ = skipCount;
+}
+
+size_t BitpackDecoder::skipFixedSizeRecords( size_t endBit )
+{
+   const unsigned bits = bitsPerRecord();
+
+   /// Skip as many whole records as we have input for
+   uint64_t count = ( endBit - inBufferFirstBit_ ) / bits;
+
+   count = std::min( count, skipCount_ );
+   count = std::min( count, maxRecordCount_ - currentRecordIndex_ );
+
+   inBufferFirstBit_ += static_cast<size_t>( count * bits );
+   currentRecordIndex_ += count;
+   skipCount_ -= count;
+
+   return static_cast<size_t>( count * bits );
 }
 
 void BitpackDecoder::inBufferShiftDown()
@@ -328,6 +422,7 @@ void BitpackDecoder::dump( int indent, std::ostream &os )
    os << space( indent ) << "bytestreamNumber:         " << bytestreamNumber_ << std::endl;
    os << space( indent ) << "currentRecordIndex:       " << currentRecordIndex_ << std::endl;
    os << space( indent ) << "maxRecordCount:           " << maxRecordCount_ << std::endl;
+   os << space( indent ) << "skipCount:                " << skipCount_ << std::endl;
    os << space( indent ) << "destBuffer:" << std::endl;
    destBuffer_->dump( indent + 4, os );
    os << space( indent ) << "inBufferFirstBit:        " << inBufferFirstBit_ << std::endl;
@@ -408,39 +503,20 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    std::cout << "  n:" << n << std::endl; //???
 #endif
 
-   if ( precision_ == E57_SINGLE )
-   {
-      /// Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const float *>( inbuf );
-
-      /// Copy floats from inbuf to destBuffer_
-      for ( unsigned i = 0; i < n; i++ )
-      {
-         float value = *inp;
+   const MemoryRepresentation representation = ( precision_ == E57_SINGLE ) ? E57_REAL32 : E57_REAL64;
 
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  got float value=" << value << std::endl;
-#endif
-         destBuffer_->setNextFloat( value );
-         inp++;
-      }
+   if ( destBuffer_->isContiguous( representation ) )
+   {
+      /// No conversion needed, so copy the bytes straight into the user's buffer
+      destBuffer_->setNextBytes( inbuf, n );
+   }
+   else if ( precision_ == E57_SINGLE )
+   {
+      setNextReals<float>( *destBuffer_, inbuf, n );
    }
    else
    { /// E57_DOUBLE precision
-      /// Form the starting address for first data location in inBuffer
-      auto inp = reinterpret_cast<const double *>( inbuf );
-
-      /// Copy doubles from inbuf to destBuffer_
-      for ( unsigned i = 0; i < n; i++ )
-      {
-         double value = *inp;
-
-#ifdef E57_MAX_VERBOSE
-         std::cout << "  got double value=" << value << std::endl;
-#endif
-         destBuffer_->setNextDouble( value );
-         inp++;
-      }
+      setNextReals<double>( *destBuffer_, inbuf, n );
    }
 
    /// Update counts of records processed
@@ -450,6 +526,11 @@ size_t BitpackFloatDecoder::inputProcessAligned( const char *inbuf, const size_t
    return ( n * 8 * typeSize );
 }
 
+unsigned BitpackFloatDecoder::bitsPerRecord() const
+{
+   return ( precision_ == E57_SINGLE ) ? 32 : 64;
+}
+
 #ifdef E57_DEBUG
 void BitpackFloatDecoder::dump( int indent, std::ostream &os )
 {
@@ -494,9 +575,10 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
    size_t nBytesAvailable = ( endBit - firstBit ) >> 3;
    size_t nBytesRead = 0;
 
-   /// Loop until we've finished all the records, or ran out of input currently
-   /// available
-   while ( currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable )
+   /// Loop until we've finished all the records, ran out of input currently
+   /// available, or filled destBuffer (skipped records don't go in it)
+   while ( currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable &&
+           ( skipCount_ > 0 || destBuffer_->nextIndex() < destBuffer_->capacity() ) )
    {
 #ifdef E57_MAX_VERBOSE
       std::cout << "read string loop1: readingPrefix=" << readingPrefix_ << " prefixLength=" << prefixLength_
@@ -595,8 +677,15 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
          /// Check if completed reading the string contents
          if ( nBytesStringRead_ == stringLength_ )
          {
-            /// Save accumulated string to dest buffer
-            destBuffer_->setNextString( currentString_ );
+            /// Save accumulated string to dest buffer, unless skipping after a seek
+            if ( skipCount_ > 0 )
+            {
+               --skipCount_;
+            }
+            else
+            {
+               destBuffer_->setNextString( currentString_ );
+            }
             currentRecordIndex_++;
 
             /// Get ready to read next prefix
@@ -615,6 +704,25 @@ size_t BitpackStringDecoder::inputProcessAligned( const char *inbuf, const size_
    return ( nBytesRead * 8 );
 }
 
+void BitpackStringDecoder::stateReset( uint64_t recordIndex, uint64_t skipCount )
+{
+   BitpackDecoder::stateReset( recordIndex, skipCount );
+
+   readingPrefix_ = true;
+   prefixLength_ = 1;
+   memset( prefixBytes_, 0, sizeof( prefixBytes_ ) );
+   nBytesPrefixRead_ = 0;
+   stringLength_ = 0;
+   currentString_ = "";
+   nBytesStringRead_ = 0;
+}
+
+unsigned BitpackStringDecoder::bitsPerRecord() const
+{
+   /// Strings vary in length
+   return 0;
+}
+
 #ifdef E57_DEBUG
 void BitpackStringDecoder::dump( int indent, std::ostream &os )
 {
@@ -653,7 +761,17 @@ BitpackIntegerDecoder<RegisterT>::BitpackIntegerDecoder( bool isScaledInteger, u
                                                                // imf->parentFile()  --> ImageFile?
 
    bitsPerRecord_ = imf->bitsNeeded( minimum_, maximum_ );
-   destBitMask_ = ( bitsPerRecord_ == 64 ) ? ~0 : static_cast<RegisterT>( 1ULL << bitsPerRecord_ ) - 1;
+
+   unpackScaled_ = isScaledInteger_ && canUnpackScaled( *destBuffer_, scale_, offset_ );
+}
+
+template <typename RegisterT>
+void BitpackIntegerDecoder<RegisterT>::destBufferSetNew( std::vector<SourceDestBuffer> &dbufs )
+{
+   BitpackDecoder::destBufferSetNew( dbufs );
+
+   /// The new buffer may not want scaling
+   unpackScaled_ = isScaledInteger_ && canUnpackScaled( *destBuffer_, scale_, offset_ );
 }
 
 template <typename RegisterT>
@@ -704,99 +822,53 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    std::cout << "  recordCount=" << recordCount << std::endl;
 #endif
 
-   auto inp = reinterpret_cast<const RegisterT *>( inbuf );
-   unsigned wordPosition = 0; /// The index in inbuf of the word we are currently working on.
-
-   // clang-format off
-   /// For example on little endian machine:
-   /// Assume: registerT=uint32_t, bitOffset=20, destBitMask=0x00007fff (for a 15 bit value).
-   /// inp[wordPosition]                    LLLLLLLL LLLLXXXX XXXXXXXX XXXXXXXX   Note LSB of value is at bit20
-   /// inp(wordPosition+1]                  XXXXXXXX XXXXXXXX XXXXXXXX XXXXXHHH   H=high bits of value, X=uninteresting bits
-   /// low = inp[i] >> bitOffset            00000000 00000000 0000LLLL LLLLLLLL   L=low bits of value, X=uninteresting bits
-   /// high = inp[i+1] << (32-bitOffset)    XXXXXXXX XXXXXXXX XHHH0000 00000000
-   /// w = high | low                       XXXXXXXX XXXXXXXX XHHHLLLL LLLLLLLL
-   /// destBitmask                          00000000 00000000 01111111 11111111
-   /// w & mask                             00000000 00000000 0HHHLLLL LLLLLLLL
-   // clang-format on
+   /// Unpack a block of values at a time, then store them in the user's dest buffer.
+   /// Only the bytes holding the input bits are read, the kernels don't rely on inbuf being padded or aligned.
+   const size_t byteCount = ( endBit + 7 ) / 8;
+
+   int64_t values[cUnpackBlockSize];
+   double scaledValues[cUnpackBlockSize];
 
    size_t bitOffset = firstBit;
 
-   for ( size_t i = 0; i < recordCount; i++ )
+   for ( size_t done = 0; done < recordCount; )
    {
-      /// Get lower word (contains at least the LSbit of the value),
-      RegisterT low = inp[wordPosition];
-
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  bitOffset: " << bitOffset << std::endl;
-      std::cout << "  low: " << binaryString( low ) << std::endl;
-#endif
+      const size_t blockCount = std::min( cUnpackBlockSize, recordCount - done );
 
-      RegisterT w;
-      if ( bitOffset == 0 )
+      if ( unpackScaled_ )
       {
-         /// The left shift (used below) is not defined if shift is >= size of
-         /// word
-         w = low;
-      }
-      // Avoid reading the next word, unless it is needed
-      // If the last record finishes on the last bit of input, avoid UMR
-      else if ( bitOffset + bitsPerRecord_ <= RegisterBits )
-      {
-         w = low >> bitOffset;
+         /// Floating point dest buffers get the scaled values in one pass
+         unpackScaledBits( inbuf, byteCount, bitOffset, bitsPerRecord_, blockCount, minimum_, scale_, offset_,
+                           scaledValues );
+
+         destBuffer_->setNextBlock( scaledValues, blockCount );
       }
       else
       {
-         /// Get upper word (may or may not contain interesting bits),
-         RegisterT high = inp[wordPosition + 1];
+         /// Add minimum_ to each value to get back what writer originally sent
+         unpackBits( inbuf, byteCount, bitOffset, bitsPerRecord_, blockCount, minimum_, values );
 
 #ifdef E57_MAX_VERBOSE
-         std::cout << "  high:" << binaryString( high ) << std::endl;
-#endif
-
-         /// Shift high to just above the lower bits, shift low LSBit to bit0,
-         /// OR together. Note shifts are logical (not arithmetic) because using
-         /// unsigned variables.
-         w = ( high << ( RegisterBits - bitOffset ) ) | ( low >> bitOffset );
-      }
-
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  w:   " << binaryString( w ) << std::endl;
-#endif
-
-      /// Mask off uninteresting bits
-      w &= destBitMask_;
-
-      /// Add minimum_ to value to get back what writer originally sent
-      int64_t value = minimum_ + static_cast<uint64_t>( w );
-
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  Storing value=" << value << std::endl;
+         for ( size_t i = 0; i < blockCount; ++i )
+         {
+            std::cout << "  Storing value=" << values[i] << std::endl;
+         }
 #endif
 
-      /// The parameter isScaledInteger_ determines which version of
-      /// setNextInt64 gets called
-      if ( isScaledInteger_ )
-      {
-         destBuffer_->setNextInt64( value, scale_, offset_ );
-      }
-      else
-      {
-         destBuffer_->setNextInt64( value );
+         /// The parameter isScaledInteger_ determines which version of
+         /// setNextBlock gets called
+         if ( isScaledInteger_ )
+         {
+            destBuffer_->setNextBlock( values, blockCount, scale_, offset_ );
+         }
+         else
+         {
+            destBuffer_->setNextBlock( values, blockCount );
+         }
       }
 
-      /// Store the result in next available position in the user's dest buffer
-
-      /// Calc next bit alignment and which word it starts in
-      bitOffset += bitsPerRecord_;
-      if ( bitOffset >= 8 * sizeof( RegisterT ) )
-      {
-         bitOffset -= 8 * sizeof( RegisterT );
-         wordPosition++;
-      }
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  Processed " << i + 1 << " records, wordPosition=" << wordPosition << " decoder:" << std::endl;
-      dump( 4 );
-#endif
+      bitOffset += blockCount * bitsPerRecord_;
+      done += blockCount;
    }
 
    /// Update counts of records processed
@@ -806,18 +878,22 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned( const char *inbuf,
    return ( recordCount * bitsPerRecord_ );
 }
 
+template <typename RegisterT> unsigned BitpackIntegerDecoder<RegisterT>::bitsPerRecord() const
+{
+   return bitsPerRecord_;
+}
+
 #ifdef E57_DEBUG
 template <typename RegisterT> void BitpackIntegerDecoder<RegisterT>::dump( int indent, std::ostream &os )
 {
    BitpackDecoder::dump( indent, os );
    os << space( indent ) << "isScaledInteger:  " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "unpackScaled:     " << unpackScaled_ << std::endl;
    os << space( indent ) << "minimum:          " << minimum_ << std::endl;
    os << space( indent ) << "maximum:          " << maximum_ << std::endl;
    os << space( indent ) << "scale:            " << scale_ << std::endl;
    os << space( indent ) << "offset:           " << offset_ << std::endl;
    os << space( indent ) << "bitsPerRecord:    " << bitsPerRecord_ << std::endl;
-   os << space( indent ) << "destBitMask:      " << binaryString( destBitMask_ ) << " = " << hexString( destBitMask_ )
-      << std::endl;
 }
 #endif
 
@@ -860,26 +936,40 @@ size_t ConstantIntegerDecoder::inputProcess( const char *source, const size_t av
       count = static_cast<unsigned>( remainingRecordCount );
    }
 
-   if ( isScaledInteger_ )
+   /// Store a block of copies of minimum_ at a time
+   int64_t values[cUnpackBlockSize];
+
+   std::fill_n( values, cUnpackBlockSize, minimum_ );
+
+   for ( size_t done = 0; done < count; )
    {
-      for ( size_t i = 0; i < count; i++ )
+      const size_t blockCount = std::min( cUnpackBlockSize, count - done );
+
+      if ( isScaledInteger_ )
       {
-         destBuffer_->setNextInt64( minimum_, scale_, offset_ );
+         destBuffer_->setNextBlock( values, blockCount, scale_, offset_ );
       }
-   }
-   else
-   {
-      for ( size_t i = 0; i < count; i++ )
+      else
       {
-         destBuffer_->setNextInt64( minimum_ );
+         destBuffer_->setNextBlock( values, blockCount );
       }
+
+      done += blockCount;
    }
    currentRecordIndex_ += count;
    return ( count );
 }
 
-void ConstantIntegerDecoder::stateReset()
+void ConstantIntegerDecoder::stateReset( uint64_t recordIndex, uint64_t skipCount )
+{
+   /// Nothing to decode, so skipping is free
+   currentRecordIndex_ = recordIndex + skipCount;
+}
+
+unsigned ConstantIntegerDecoder::bitsPerRecord() const
 {
+   /// Doesn't use the bytestream at all
+   return 0;
 }
 
 #ifdef E57_DEBUG
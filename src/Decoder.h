@@ -43,7 +43,13 @@ namespace e57
       virtual void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) = 0;
       virtual uint64_t totalRecordsCompleted() = 0;
       virtual size_t inputProcess( const char *source, size_t count ) = 0;
-      virtual void stateReset() = 0;
+
+      /// Forget any buffered input and get ready for input starting with record recordIndex.
+      /// The first skipCount records are decoded but not stored in the destination buffer.
+      virtual void stateReset( uint64_t recordIndex, uint64_t skipCount ) = 0;
+
+      /// Number of bits each record takes in the bytestream, or 0 if it varies (or there is no bytestream)
+      virtual unsigned bitsPerRecord() const = 0;
 
       unsigned bytestreamNumber() const
       {
@@ -72,7 +78,7 @@ namespace e57
       size_t inputProcess( const char *source, size_t availableByteCount ) override;
       virtual size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) = 0;
 
-      void stateReset() override;
+      void stateReset( uint64_t recordIndex, uint64_t skipCount ) override;
 
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
@@ -82,9 +88,11 @@ namespace e57
                       uint64_t maxRecordCount );
 
       void inBufferShiftDown();
+      size_t skipFixedSizeRecords( size_t endBit );
 
       uint64_t currentRecordIndex_ = 0;
       uint64_t maxRecordCount_ = 0;
+      uint64_t skipCount_ = 0; /// number of records still to be thrown away after a seek
 
       std::shared_ptr<SourceDestBufferImpl> destBuffer_;
 
@@ -103,6 +111,7 @@ namespace e57
                            uint64_t maxRecordCount );
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
+      unsigned bitsPerRecord() const override;
 
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
@@ -117,6 +126,8 @@ namespace e57
       BitpackStringDecoder( unsigned bytestreamNumber, SourceDestBuffer &dbuf, uint64_t maxRecordCount );
 
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
+      void stateReset( uint64_t recordIndex, uint64_t skipCount ) override;
+      unsigned bitsPerRecord() const override;
 
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
@@ -137,20 +148,22 @@ namespace e57
       BitpackIntegerDecoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &dbuf, int64_t minimum,
                              int64_t maximum, double scale, double offset, uint64_t maxRecordCount );
 
+      void destBufferSetNew( std::vector<SourceDestBuffer> &dbufs ) override;
+
       size_t inputProcessAligned( const char *inbuf, size_t firstBit, size_t endBit ) override;
+      unsigned bitsPerRecord() const override;
 
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
    protected:
       bool isScaledInteger_;
+      bool unpackScaled_ = false; /// Scale values as they're unpacked, for floating point dest buffers
       int64_t minimum_;
       int64_t maximum_;
       double scale_;
       double offset_;
       unsigned bitsPerRecord_;
-      RegisterT destBitMask_;
-      static constexpr size_t RegisterBits = sizeof( RegisterT ) * 8;
    };
 
    class ConstantIntegerDecoder : public Decoder
@@ -166,7 +179,8 @@ namespace e57
       }
 
       size_t inputProcess( const char *source, size_t availableByteCount ) override;
-      void stateReset() override;
+      void stateReset( uint64_t recordIndex, uint64_t skipCount ) override;
+      unsigned bitsPerRecord() const override;
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout ) override;
 #endif
@@ -26,8 +26,10 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 
+#include "BitPack.h"
 #include "CompressedVectorNodeImpl.h"
 #include "Encoder.h"
 #include "FloatNodeImpl.h"
@@ -40,6 +42,22 @@
 
 using namespace e57;
 
+namespace
+{
+   /// Number of values the integer encoders fetch at a time before checking and packing them
+   constexpr size_t cPackBlockSize = 64;
+
+   /// Whether scaled integers coming from sbuf can be read as doubles and unscaled in one pass. Only floating point
+   /// buffers can: they convert to double exactly as getNextBlock() does for them.
+   bool canUnscale( const SourceDestBufferImpl &sbuf, double scale )
+   {
+      const MemoryRepresentation representation = sbuf.memoryRepresentation();
+
+      return sbuf.doScaling() && sbuf.doConversion() &&
+             ( ( representation == E57_REAL32 ) || ( representation == E57_REAL64 ) ) && ( scale != 0 );
+   }
+}
+
 std::shared_ptr<Encoder> Encoder::EncoderFactory( unsigned bytestreamNumber,
                                                   std::shared_ptr<CompressedVectorNodeImpl> cVector,
                                                   std::vector<SourceDestBuffer> &sbufs, ustring & /*codecPath*/ )
@@ -412,19 +430,27 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       recordCount = maxOutputRecords;
    }
 
-   if ( precision_ == E57_SINGLE )
+   const MemoryRepresentation representation = ( precision_ == E57_SINGLE ) ? E57_REAL32 : E57_REAL64;
+
+   if ( sourceBuffer_->isContiguous( representation ) )
+   {
+      /// No conversion needed, so copy the bytes straight from the user's buffer
+      sourceBuffer_->getNextBytes( &outBuffer_[outBufferEnd_], recordCount );
+   }
+   else if ( precision_ == E57_SINGLE )
    {
       /// Form the starting address for next available location in outBuffer
       auto outp = reinterpret_cast<float *>( &outBuffer_[outBufferEnd_] );
 
       /// Copy floats from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextBlock( outp, recordCount );
+
+#ifdef E57_MAX_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextFloat();
-#ifdef E57_MAX_VERBOSE
          std::cout << "encoding float: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
    else
    { /// E57_DOUBLE precision
@@ -432,13 +458,14 @@ uint64_t BitpackFloatEncoder::processRecords( size_t recordCount )
       auto outp = reinterpret_cast<double *>( &outBuffer_[outBufferEnd_] );
 
       /// Copy doubles from sourceBuffer_ to outBuffer_
+      sourceBuffer_->getNextBlock( outp, recordCount );
+
+#ifdef E57_MAX_VERBOSE
       for ( unsigned i = 0; i < recordCount; i++ )
       {
-         outp[i] = sourceBuffer_->getNextDouble();
-#ifdef E57_MAX_VERBOSE
          std::cout << "encoding double: " << outp[i] << std::endl;
-#endif
       }
+#endif
    }
 
    /// Update end of outBuffer
@@ -456,6 +483,11 @@ bool BitpackFloatEncoder::registerFlushToOutput()
    return ( true );
 }
 
+bool BitpackFloatEncoder::registerEmpty() const
+{
+   return true;
+}
+
 float BitpackFloatEncoder::bitsPerRecord()
 {
    return ( ( precision_ == E57_SINGLE ) ? 32.0F : 64.0F );
@@ -610,6 +642,11 @@ bool BitpackStringEncoder::registerFlushToOutput()
    return ( true );
 }
 
+bool BitpackStringEncoder::registerEmpty() const
+{
+   return true;
+}
+
 float BitpackStringEncoder::bitsPerRecord()
 {
    /// Return average number of bits in strings + 8 bits for prefix
@@ -656,6 +693,16 @@ BitpackIntegerEncoder<RegisterT>::BitpackIntegerEncoder( bool isScaledInteger, u
    sourceBitMask_ = ( bitsPerRecord_ == 64 ) ? ~0 : ( 1ULL << bitsPerRecord_ ) - 1;
    registerBitsUsed_ = 0;
    register_ = 0;
+   unscale_ = isScaledInteger_ && canUnscale( *sourceBuffer_, scale_ );
+}
+
+template <typename RegisterT>
+void BitpackIntegerEncoder<RegisterT>::sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs )
+{
+   BitpackEncoder::sourceBufferSetNew( sbufs );
+
+   /// The new buffer may not want scaling
+   unscale_ = isScaledInteger_ && canUnscale( *sourceBuffer_, scale_ );
 }
 
 template <typename RegisterT> uint64_t BitpackIntegerEncoder<RegisterT>::processRecords( size_t recordCount )
@@ -705,110 +752,87 @@ template <typename RegisterT> uint64_t BitpackIntegerEncoder<RegisterT>::process
 #endif
 
    /// Form the starting address for next available location in outBuffer
-   auto outp = reinterpret_cast<RegisterT *>( &outBuffer_[outBufferEnd_] );
-   unsigned outTransferred = 0;
+   char *outp = &outBuffer_[outBufferEnd_];
+   size_t outTransferred = 0;
+
+   /// Pack from a 64-bit word, starting with the bits already in the register
+   auto pending = static_cast<uint64_t>( register_ );
+   unsigned pendingBitCount = registerBitsUsed_;
 
-   /// Copy bits from sourceBuffer_ to outBuffer_
-   for ( unsigned i = 0; i < recordCount; i++ )
+   int64_t values[cPackBlockSize];
+   double realValues[cPackBlockSize];
+
+   /// Copy bits from sourceBuffer_ to outBuffer_ a block at a time
+   for ( size_t done = 0; done < recordCount; )
    {
-      int64_t rawValue;
+      const size_t blockCount = std::min( cPackBlockSize, recordCount - done );
 
       /// The parameter isScaledInteger_ determines which version of
-      /// getNextInt64 gets called
-      if ( isScaledInteger_ )
+      /// getNextBlock gets called
+      if ( unscale_ )
+      {
+         /// Floating point source buffers are scaled and rounded in one pass
+         sourceBuffer_->getNextBlock( realValues, blockCount );
+
+         const size_t notRepresentable = unscaleValues( realValues, blockCount, scale_, offset_, values );
+
+         if ( notRepresentable < blockCount )
+         {
+            const double doubleRawValue = floor( ( realValues[notRepresentable] - offset_ ) / scale_ + 0.5 );
+
+            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
+                                  "pathName=" + sourceBuffer_->pathName() + " value=" + toString( doubleRawValue ) );
+         }
+      }
+      else if ( isScaledInteger_ )
       {
-         rawValue = sourceBuffer_->getNextInt64( scale_, offset_ );
+         sourceBuffer_->getNextBlock( values, blockCount, scale_, offset_ );
       }
       else
       {
-         rawValue = sourceBuffer_->getNextInt64();
+         sourceBuffer_->getNextBlock( values, blockCount );
       }
 
-      /// Enforce min/max specification on value
-      if ( rawValue < minimum_ || maximum_ < rawValue )
+      /// Enforce min/max specification on values
+      const size_t outOfBounds = findOutOfBounds( values, blockCount, minimum_, maximum_ );
+
+      if ( outOfBounds < blockCount )
       {
-         throw E57_EXCEPTION2( E57_ERROR_VALUE_OUT_OF_BOUNDS, "rawValue=" + toString( rawValue ) +
+         throw E57_EXCEPTION2( E57_ERROR_VALUE_OUT_OF_BOUNDS, "rawValue=" + toString( values[outOfBounds] ) +
                                                                  " minimum=" + toString( minimum_ ) +
                                                                  " maximum=" + toString( maximum_ ) );
       }
 
-      auto uValue = static_cast<uint64_t>( rawValue - minimum_ );
+      outTransferred += packBits( values, blockCount, bitsPerRecord_, minimum_, pending, pendingBitCount,
+                                  outp + outTransferred );
+      done += blockCount;
 
 #ifdef E57_MAX_VERBOSE
-      std::cout << "encoding integer rawValue=" << binaryString( rawValue ) << " = " << hexString( rawValue )
-                << std::endl;
-      std::cout << "                 uValue  =" << binaryString( uValue ) << " = " << hexString( uValue ) << std::endl;
-#endif
-#ifdef E57_DEBUG
-      /// Double check that no bits outside of the mask are set
-      if ( uValue & ~static_cast<uint64_t>( sourceBitMask_ ) )
-      {
-         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "uValue=" + toString( uValue ) );
-      }
-#endif
-      /// Mask off upper bits (just in case)
-      uValue &= static_cast<uint64_t>( sourceBitMask_ );
-
-      /// See if uValue bits will fit in register
-      unsigned newRegisterBitsUsed = registerBitsUsed_ + bitsPerRecord_;
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  registerBitsUsed=" << registerBitsUsed_ << "  newRegisterBitsUsed=" << newRegisterBitsUsed
-                << std::endl;
-#endif
-      if ( newRegisterBitsUsed > 8 * sizeof( RegisterT ) )
-      {
-         /// Have more than one registers worth, fill register, transfer, then
-         /// fill some more
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
-#ifdef E57_DEBUG
-         /// Before transfer, double check address within bounds
-         if ( outTransferred >= transferMax )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "outTransferred=" + toString( outTransferred ) + " transferMax" +
-                                                         toString( transferMax ) );
-         }
+      std::cout << "  After " << outTransferred << " bytes and " << done << " records, pendingBitCount="
+                << pendingBitCount << std::endl;
 #endif
-         outp[outTransferred] = register_;
+   }
 
-         outTransferred++;
+   /// Transfer any whole registers' worth of the leftover bits, and keep the rest in the register
+   const size_t wholeRegisterBytes = ( pendingBitCount / ( 8 * sizeof( RegisterT ) ) ) * sizeof( RegisterT );
 
-         register_ = static_cast<RegisterT>( uValue ) >> ( 8 * sizeof( RegisterT ) - registerBitsUsed_ );
-         registerBitsUsed_ = newRegisterBitsUsed - 8 * sizeof( RegisterT );
-      }
-      else if ( newRegisterBitsUsed == 8 * sizeof( RegisterT ) )
-      {
-         /// Input will exactly fill register, insert value, then transfer
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
-#ifdef E57_DEBUG
-         /// Before transfer, double check address within bounds
-         if ( outTransferred >= transferMax )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "outTransferred=" + toString( outTransferred ) + " transferMax" +
-                                                         toString( transferMax ) );
-         }
-#endif
-         outp[outTransferred] = register_;
+   memcpy( outp + outTransferred, &pending, wholeRegisterBytes );
+   outTransferred += wholeRegisterBytes;
 
-         outTransferred++;
+   register_ = static_cast<RegisterT>( pending >> ( 8 * wholeRegisterBytes ) );
+   registerBitsUsed_ = pendingBitCount - static_cast<unsigned>( 8 * wholeRegisterBytes );
 
-         register_ = 0;
-         registerBitsUsed_ = 0;
-      }
-      else
-      {
-         /// There is extra room in register, insert value, but don't do
-         /// transfer yet
-         register_ |= static_cast<RegisterT>( uValue ) << registerBitsUsed_;
-         registerBitsUsed_ = newRegisterBitsUsed;
-      }
-#ifdef E57_MAX_VERBOSE
-      std::cout << "  After " << outTransferred << " transfers and " << i + 1 << " records, encoder:" << std::endl;
-      dump( 4 );
-#endif
+#ifdef E57_DEBUG
+   /// Double check address within bounds
+   if ( outTransferred > transferMax * sizeof( RegisterT ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "outTransferred=" + toString( outTransferred ) + " transferMax" +
+                                                   toString( transferMax ) );
    }
+#endif
 
    /// Update tail of output buffer
-   outBufferEnd_ += outTransferred * sizeof( RegisterT );
+   outBufferEnd_ += outTransferred;
 #ifdef E57_DEBUG
    /// Double check end is ok
    if ( outBufferEnd_ > outBuffer_.size() )
@@ -852,6 +876,11 @@ template <typename RegisterT> bool BitpackIntegerEncoder<RegisterT>::registerFlu
    return true;
 }
 
+template <typename RegisterT> bool BitpackIntegerEncoder<RegisterT>::registerEmpty() const
+{
+   return ( registerBitsUsed_ == 0 );
+}
+
 template <typename RegisterT> float BitpackIntegerEncoder<RegisterT>::bitsPerRecord()
 {
    return ( static_cast<float>( bitsPerRecord_ ) );
@@ -862,6 +891,7 @@ template <typename RegisterT> void BitpackIntegerEncoder<RegisterT>::dump( int i
 {
    BitpackEncoder::dump( indent, os );
    os << space( indent ) << "isScaledInteger:  " << isScaledInteger_ << std::endl;
+   os << space( indent ) << "unscale:          " << unscale_ << std::endl;
    os << space( indent ) << "minimum:          " << minimum_ << std::endl;
    os << space( indent ) << "maximum:          " << maximum_ << std::endl;
    os << space( indent ) << "scale:            " << scale_ << std::endl;
@@ -889,15 +919,24 @@ uint64_t ConstantIntegerEncoder::processRecords( size_t recordCount )
    dump( 4 );
 #endif
 
-   /// Check that all source values are == minimum_
-   for ( unsigned i = 0; i < recordCount; i++ )
+   int64_t values[cPackBlockSize];
+
+   /// Check that all source values are == minimum_, a block at a time
+   for ( size_t done = 0; done < recordCount; )
    {
-      int64_t nextInt64 = sourceBuffer_->getNextInt64();
-      if ( nextInt64 != minimum_ )
+      const size_t blockCount = std::min( cPackBlockSize, recordCount - done );
+
+      sourceBuffer_->getNextBlock( values, blockCount );
+
+      const size_t outOfBounds = findOutOfBounds( values, blockCount, minimum_, minimum_ );
+
+      if ( outOfBounds < blockCount )
       {
-         throw E57_EXCEPTION2( E57_ERROR_VALUE_OUT_OF_BOUNDS,
-                               "nextInt64=" + toString( nextInt64 ) + " minimum=" + toString( minimum_ ) );
+         throw E57_EXCEPTION2( E57_ERROR_VALUE_OUT_OF_BOUNDS, "nextInt64=" + toString( values[outOfBounds] ) +
+                                                                 " minimum=" + toString( minimum_ ) );
       }
+
+      done += blockCount;
    }
 
    /// Update counts of records processed
@@ -927,6 +966,11 @@ bool ConstantIntegerEncoder::registerFlushToOutput()
    return ( true );
 }
 
+bool ConstantIntegerEncoder::registerEmpty() const
+{
+   return true;
+}
+
 size_t ConstantIntegerEncoder::outputAvailable() const
 {
    /// We don't produce any output
@@ -45,6 +45,7 @@ namespace e57
       virtual uint64_t currentRecordIndex() = 0;
       virtual float bitsPerRecord() = 0;
       virtual bool registerFlushToOutput() = 0;
+      virtual bool registerEmpty() const = 0; /// true if no bits are waiting to be written to output
 
       virtual size_t outputAvailable() const = 0;                  /// number of bytes that can be read
       virtual void outputRead( char *dest, size_t byteCount ) = 0; /// get data from encoder
@@ -76,6 +77,7 @@ namespace e57
       uint64_t currentRecordIndex() override;
       float bitsPerRecord() override = 0;
       bool registerFlushToOutput() override = 0;
+      bool registerEmpty() const override = 0;
 
       size_t outputAvailable() const override;                  /// number of bytes that can be read
       void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
@@ -112,6 +114,7 @@ namespace e57
 
       uint64_t processRecords( size_t recordCount ) override;
       bool registerFlushToOutput() override;
+      bool registerEmpty() const override;
       float bitsPerRecord() override;
 
 #ifdef E57_DEBUG
@@ -128,6 +131,7 @@ namespace e57
 
       uint64_t processRecords( size_t recordCount ) override;
       bool registerFlushToOutput() override;
+      bool registerEmpty() const override;
       float bitsPerRecord() override;
 
 #ifdef E57_DEBUG
@@ -147,8 +151,11 @@ namespace e57
       BitpackIntegerEncoder( bool isScaledInteger, unsigned bytestreamNumber, SourceDestBuffer &sbuf,
                              unsigned outputMaxSize, int64_t minimum, int64_t maximum, double scale, double offset );
 
+      void sourceBufferSetNew( std::vector<SourceDestBuffer> &sbufs ) override;
+
       uint64_t processRecords( size_t recordCount ) override;
       bool registerFlushToOutput() override;
+      bool registerEmpty() const override;
       float bitsPerRecord() override;
 
 #ifdef E57_DEBUG
@@ -156,6 +163,7 @@ namespace e57
 #endif
    protected:
       bool isScaledInteger_;
+      bool unscale_ = false; /// Unscale values in bulk, for floating point source buffers
       int64_t minimum_;
       int64_t maximum_;
       double scale_;
@@ -175,6 +183,7 @@ namespace e57
       uint64_t currentRecordIndex() override;
       float bitsPerRecord() override;
       bool registerFlushToOutput() override;
+      bool registerEmpty() const override;
 
       size_t outputAvailable() const override;                  /// number of bytes that can be read
       void outputRead( char *dest, size_t byteCount ) override; /// get data from encoder
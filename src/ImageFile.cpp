@@ -170,14 +170,27 @@ StringNode, BlobNode, StructureNode, VectorNode, CompressedVectorNode,
 E57Exception, E57Utilities::E57Utilities
 */
 ImageFile::ImageFile( const ustring &fname, const ustring &mode, ReadChecksumPolicy checksumPolicy ) :
-   impl_( new ImageFileImpl( checksumPolicy ) )
+   ImageFile( fname, mode, ImageFileOptions{ checksumPolicy } )
+{
+}
+
+/*!
+@brief   Open an ASTM E57 imaging data file for reading/writing using the given options.
+@param   [in] fname File name to open.
+@param   [in] mode Either "w" for writing or "r" for reading.
+@param   [in] options Options controlling how the file is read or written.
+@details See ImageFile::ImageFile( const ustring &, const ustring &, ReadChecksumPolicy ) for details.
+@see     ImageFileOptions
+*/
+ImageFile::ImageFile( const ustring &fname, const ustring &mode, const ImageFileOptions &options ) :
+   impl_( new ImageFileImpl( options ) )
 {
    /// Do second phase of construction, now that ImageFile object is complete.
    impl_->construct2( fname, mode );
 }
 
 ImageFile::ImageFile( const char *input, const uint64_t size, ReadChecksumPolicy checksumPolicy ) :
-   impl_( new ImageFileImpl( checksumPolicy ) )
+   impl_( new ImageFileImpl( ImageFileOptions{ checksumPolicy } ) )
 {
    impl_->construct2( input, size );
 }
@@ -607,12 +620,6 @@ void ImageFile::checkInvariant( bool doRecurse ) const
       throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
    }
 
-   // Can't have more than one writer
-   if ( 1 < wCount )
-   {
-      throw E57_EXCEPTION1( E57_ERROR_INVARIANCE_VIOLATION );
-   }
-
    // If have writer
    if ( wCount > 0 )
    {
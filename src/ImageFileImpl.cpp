@@ -29,7 +29,10 @@
 #include "CheckedFile.h"
 #include "E57Version.h"
 #include "E57XmlParser.h"
+#include "Packet.h"
+#include "PacketIndex.h"
 #include "StringFunctions.h"
+#include "StringNodeImpl.h"
 #include "StructureNodeImpl.h"
 
 namespace e57
@@ -75,10 +78,15 @@ namespace e57
    }
 #endif
 
-   ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy ) :
+   ImageFileImpl::ImageFileImpl( const ImageFileOptions &options ) :
       isWriter_( false ), writerCount_( 0 ), readerCount_( 0 ),
-      checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ), file_( nullptr ), xmlLogicalOffset_( 0 ),
-      xmlLogicalLength_( 0 ), unusedLogicalStart_( 0 )
+      checksumPolicy( std::max( 0, std::min( options.checksumPolicy, 100 ) ) ), memoryMapped_( options.memoryMapped ),
+      backgroundWrite_( options.backgroundWrite ), chunkRecordCount_( ( options.chunkRecordCount + 63 ) / 64 * 64 ),
+      packetCacheSize_( options.packetCacheSize ), readAheadPacketCount_( options.readAheadPacketCount ),
+      packetIndexPath_( options.packetIndexPath ), decodeThreadCount_( options.decodeThreadCount ),
+      decodeExecutor_( options.decodeExecutor ), encodeThreadCount_( options.encodeThreadCount ),
+      encodeExecutor_( options.encodeExecutor ), file_( nullptr ), xmlLogicalOffset_( 0 ), xmlLogicalLength_( 0 ),
+      unusedLogicalStart_( 0 )
    {
       /// First phase of construction, can't do much until have the ImageFile
       /// object. See ImageFileImpl::construct2() for second phase.
@@ -138,7 +146,8 @@ namespace e57
       try
       {
          /// Open file for reading.
-         file_ = new CheckedFile( fileName_, CheckedFile::ReadOnly, checksumPolicy );
+         file_ = new CheckedFile( fileName_, memoryMapped_ ? CheckedFile::ReadOnlyMapped : CheckedFile::ReadOnly,
+                                  checksumPolicy );
 
          std::shared_ptr<StructureNodeImpl> root( new StructureNodeImpl( imf ) );
          root_ = root;
@@ -247,11 +256,15 @@ namespace e57
 
    void ImageFileImpl::incrWriterCount()
    {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
       writerCount_++;
    }
 
    void ImageFileImpl::decrWriterCount()
    {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
       writerCount_--;
 #ifdef E57_MAX_DEBUG
       if ( writerCount_ < 0 )
@@ -265,11 +278,15 @@ namespace e57
 
    void ImageFileImpl::incrReaderCount()
    {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
       readerCount_++;
    }
 
    void ImageFileImpl::decrReaderCount()
    {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
       readerCount_--;
 #ifdef E57_MAX_DEBUG
       if ( readerCount_ < 0 )
@@ -298,6 +315,11 @@ namespace e57
 
       if ( isWriter_ )
       {
+         /// Writers closed while another one had the tail may still be waiting to append their sections. The XML
+         /// points at those sections, so append them now. A writer which still has the tail was never closed, so
+         /// its section is abandoned either way.
+         releaseTail();
+
          /// Go to end of file, note physical position
          xmlLogicalOffset_ = unusedLogicalStart_;
          file_->seek( xmlLogicalOffset_, CheckedFile::Logical );
@@ -343,6 +365,26 @@ namespace e57
          file_->close();
       }
 
+      packetCache_.reset();
+      packetCacheInUse_ = false;
+      packetCacheBudget_.reset();
+      pendingSections_.clear();
+      tailInUse_ = false;
+      packetIndexFile_.reset();
+
+      /// Our executor uses our threads
+      if ( decodeThreadPool_ )
+      {
+         decodeThreadPool_.reset();
+         decodeExecutor_ = nullptr;
+      }
+
+      if ( encodeThreadPool_ )
+      {
+         encodeThreadPool_.reset();
+         encodeExecutor_ = nullptr;
+      }
+
       delete file_;
       file_ = nullptr;
    }
@@ -366,6 +408,26 @@ namespace e57
          file_->close();
       }
 
+      packetCache_.reset();
+      packetCacheInUse_ = false;
+      packetCacheBudget_.reset();
+      pendingSections_.clear();
+      tailInUse_ = false;
+      packetIndexFile_.reset();
+
+      /// Our executor uses our threads
+      if ( decodeThreadPool_ )
+      {
+         decodeThreadPool_.reset();
+         decodeExecutor_ = nullptr;
+      }
+
+      if ( encodeThreadPool_ )
+      {
+         encodeThreadPool_.reset();
+         encodeExecutor_ = nullptr;
+      }
+
       delete file_;
       file_ = nullptr;
    }
@@ -382,11 +444,15 @@ namespace e57
 
    int ImageFileImpl::writerCount() const
    {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
       return writerCount_;
    }
 
    int ImageFileImpl::readerCount() const
    {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
       return readerCount_;
    }
 
@@ -410,6 +476,8 @@ namespace e57
 
    uint64_t ImageFileImpl::allocateSpace( uint64_t byteCount, bool doExtendNow )
    {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
       uint64_t oldLogicalStart = unusedLogicalStart_;
 
       /// Reserve space at end of file
@@ -430,6 +498,226 @@ namespace e57
       return file_;
    }
 
+   bool ImageFileImpl::acquireTail()
+   {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
+      if ( tailInUse_ )
+      {
+         return false;
+      }
+
+      tailInUse_ = true;
+
+      return true;
+   }
+
+   void ImageFileImpl::releaseTail()
+   {
+      std::exception_ptr error;
+
+      while ( true )
+      {
+         std::function<void()> append;
+
+         {
+            std::lock_guard<std::mutex> lock( writerMutex_ );
+
+            if ( pendingSections_.empty() )
+            {
+               tailInUse_ = false;
+               break;
+            }
+
+            append = std::move( pendingSections_.front() );
+            pendingSections_.pop_front();
+         }
+
+         /// Their writers have been closed, so carry on with the rest if one fails & report it to our caller
+         try
+         {
+            append();
+         }
+         catch ( ... )
+         {
+            if ( !error )
+            {
+               error = std::current_exception();
+            }
+         }
+      }
+
+      if ( error )
+      {
+         std::rethrow_exception( error );
+      }
+   }
+
+   void ImageFileImpl::appendSection( const std::function<void()> &append )
+   {
+      {
+         std::lock_guard<std::mutex> lock( writerMutex_ );
+
+         if ( tailInUse_ )
+         {
+#ifdef E57_MAX_VERBOSE
+            std::cout << "ImageFileImpl::appendSection() queued, pendingSections=" << pendingSections_.size() + 1
+                      << std::endl;
+#endif
+            pendingSections_.push_back( append );
+            return;
+         }
+
+         tailInUse_ = true;
+      }
+
+      std::exception_ptr error;
+
+      try
+      {
+         append();
+      }
+      catch ( ... )
+      {
+         error = std::current_exception();
+      }
+
+      releaseTail();
+
+      if ( error )
+      {
+         std::rethrow_exception( error );
+      }
+   }
+
+   PacketReadCache *ImageFileImpl::acquirePacketCache( std::unique_ptr<PacketReadCache> &ownCache )
+   {
+      const auto budget = packetCacheBudget();
+
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
+      const auto packetCount = static_cast<unsigned>( std::max<size_t>( packetCacheSize_ / DATA_PACKET_MAX, 1 ) );
+
+      if ( !packetCache_ )
+      {
+         packetCache_.reset( new PacketReadCache( file_, packetCount, budget ) );
+      }
+
+      if ( !packetCacheInUse_ )
+      {
+         packetCacheInUse_ = true;
+
+         return packetCache_.get();
+      }
+
+      /// Readers may be on different threads, so they can't share the cache, but they do share its budget
+      ownCache.reset( new PacketReadCache( file_, packetCount, budget ) );
+
+      return ownCache.get();
+   }
+
+   void ImageFileImpl::releasePacketCache( const PacketReadCache *cache )
+   {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
+      if ( ( cache != nullptr ) && ( cache == packetCache_.get() ) )
+      {
+         packetCacheInUse_ = false;
+      }
+   }
+
+   std::shared_ptr<PacketCacheBudget> ImageFileImpl::packetCacheBudget()
+   {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
+      if ( !packetCacheBudget_ )
+      {
+         packetCacheBudget_ = std::make_shared<PacketCacheBudget>( packetCacheSize_ );
+      }
+
+      return packetCacheBudget_;
+   }
+
+   const TaskExecutor &ImageFileImpl::decodeExecutor()
+   {
+      std::lock_guard<std::mutex> lock( readerMutex_ );
+
+      if ( !decodeExecutor_ )
+      {
+         decodeThreadPool_.reset( new ThreadPool( decodeThreadCount_ ) );
+
+         ThreadPool *threadPool = decodeThreadPool_.get();
+
+         decodeExecutor_ = [threadPool]( std::function<void()> task ) { threadPool->submit( std::move( task ) ); };
+      }
+
+      return decodeExecutor_;
+   }
+
+   const TaskExecutor &ImageFileImpl::encodeExecutor()
+   {
+      std::lock_guard<std::mutex> lock( writerMutex_ );
+
+      if ( !encodeExecutor_ )
+      {
+         encodeThreadPool_.reset( new ThreadPool( encodeThreadCount_ ) );
+
+         ThreadPool *threadPool = encodeThreadPool_.get();
+
+         encodeExecutor_ = [threadPool]( std::function<void()> task ) { threadPool->submit( std::move( task ) ); };
+      }
+
+      return encodeExecutor_;
+   }
+
+   const PacketIndex *ImageFileImpl::packetIndex( uint64_t sectionLogicalStart, uint64_t dataLogicalOffset,
+                                                  uint64_t sectionEndLogicalOffset )
+   {
+      PacketIndexFile *indexFile = nullptr;
+
+      {
+         std::lock_guard<std::mutex> lock( readerMutex_ );
+
+         if ( !packetIndexFile_ )
+         {
+            /// Tie the sidecar to this version of the file. It's no use while writing, the file is still changing.
+            PacketIndexFile::Key key;
+            key.fileSize = file_->length( CheckedFile::Physical );
+            key.modificationTime = file_->modificationTime();
+
+            if ( root_->isDefined( "guid" ) )
+            {
+               NodeImplSharedPtr guidNode = root_->get( "guid" );
+
+               if ( guidNode->type() == E57_STRING )
+               {
+                  key.guid = std::static_pointer_cast<StringNodeImpl>( guidNode )->value();
+               }
+            }
+
+            /// Without the modification time a rewrite of the file with the same size & GUID would match, so don't
+            /// use a sidecar at all.
+            const bool useSidecar = !isWriter_ && ( key.modificationTime != 0 );
+
+            packetIndexFile_.reset( new PacketIndexFile( useSidecar ? packetIndexPath_ : ustring(), key ) );
+         }
+
+         indexFile = packetIndexFile_.get();
+      }
+
+      const PacketIndex *index = indexFile->find( sectionLogicalStart );
+
+      if ( index != nullptr )
+      {
+         return index;
+      }
+
+      /// Scan the packets without holding up other readers. The indexes look after their own locking.
+      std::unique_ptr<PacketIndex> newIndex( new PacketIndex( file_, dataLogicalOffset, sectionEndLogicalOffset ) );
+
+      return indexFile->add( sectionLogicalStart, std::move( newIndex ) );
+   }
+
    ustring ImageFileImpl::fileName() const
    {
       // don't checkImageFileOpen, since need to get fileName to report not open
@@ -27,13 +27,21 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 
 #include "Common.h"
+#include "ThreadPool.h"
 
 namespace e57
 {
    class CheckedFile;
+   class PacketIndex;
+   class PacketIndexFile;
+   class PacketCacheBudget;
+   class PacketReadCache;
 
    struct E57FileHeader;
    struct NameSpace;
@@ -41,7 +49,7 @@ namespace e57
    class ImageFileImpl : public std::enable_shared_from_this<ImageFileImpl>
    {
    public:
-      explicit ImageFileImpl( ReadChecksumPolicy policy );
+      explicit ImageFileImpl( const ImageFileOptions &options );
       void construct2( const ustring &fileName, const ustring &mode );
       void construct2( const char *input, uint64_t size );
       std::shared_ptr<StructureNodeImpl> root();
@@ -54,9 +62,39 @@ namespace e57
       ~ImageFileImpl();
 
       uint64_t allocateSpace( uint64_t byteCount, bool doExtendNow );
+
+      /// CompressedVector binary sections must be contiguous, so writers take turns appending them to the end of
+      /// the file. acquireTail() returns false if another writer is appending, releaseTail() ends our turn.
+      bool acquireTail();
+      void releaseTail();
+
+      /// Call append to add a section to the end of the file now if no writer is appending, otherwise queue it for
+      /// when the one that is releases the tail
+      void appendSection( const std::function<void()> &append );
       CheckedFile *file() const;
       ustring fileName() const;
 
+      /// Packet cache for a reader: the one shared by readers of this file (created on first use) if no other
+      /// reader has it, otherwise a new one with the same budget put in ownCache. Give it back with
+      /// releasePacketCache().
+      PacketReadCache *acquirePacketCache( std::unique_ptr<PacketReadCache> &ownCache );
+      void releasePacketCache( const PacketReadCache *cache );
+
+      /// The packetCacheSize bytes that all the packet caches of this file allocate their buffers from
+      std::shared_ptr<PacketCacheBudget> packetCacheBudget();
+
+      /// Index of the data packets of a compressed vector section, built by scanning them the first time it is
+      /// needed & kept in the sidecar file if there is one
+      const PacketIndex *packetIndex( uint64_t sectionLogicalStart, uint64_t dataLogicalOffset,
+                                      uint64_t sectionEndLogicalOffset );
+
+      /// Runs tasks for decoding in parallel: the caller's executor if one was given, otherwise our own threads,
+      /// which are started on first use
+      const TaskExecutor &decodeExecutor();
+
+      /// Same for encoding
+      const TaskExecutor &encodeExecutor();
+
       /// Manipulate registered extensions in the file
       void extensionsAdd( const ustring &prefix, const ustring &uri );
       bool extensionsLookupPrefix( const ustring &prefix, ustring &uri ) const;
@@ -105,9 +143,34 @@ namespace e57
       int readerCount_;
 
       ReadChecksumPolicy checksumPolicy;
+      bool memoryMapped_;
+      bool backgroundWrite_;
+      uint64_t chunkRecordCount_;
+      size_t packetCacheSize_;
+      unsigned readAheadPacketCount_;
+      ustring packetIndexPath_;
+      unsigned decodeThreadCount_;
+      TaskExecutor decodeExecutor_;
+      unsigned encodeThreadCount_;
+      TaskExecutor encodeExecutor_;
 
       CheckedFile *file_;
 
+      /// Guards the reader count & the state shared by readers, which may be on different threads
+      mutable std::mutex readerMutex_;
+
+      /// Guards the writer count, space allocation & the tail, since writers may also be on different threads
+      mutable std::mutex writerMutex_;
+      bool tailInUse_ = false;
+      std::deque<std::function<void()>> pendingSections_; /// appendSection() calls waiting for the tail
+
+      std::shared_ptr<PacketCacheBudget> packetCacheBudget_;
+      std::unique_ptr<PacketReadCache> packetCache_;
+      bool packetCacheInUse_ = false;
+      std::unique_ptr<PacketIndexFile> packetIndexFile_;
+      std::unique_ptr<ThreadPool> decodeThreadPool_;
+      std::unique_ptr<ThreadPool> encodeThreadPool_;
+
       /// Read file attributes
       uint64_t xmlLogicalOffset_;
       uint64_t xmlLogicalLength_;
@@ -25,6 +25,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
 
 #include "CheckedFile.h"
@@ -33,30 +35,11 @@
 
 using namespace e57;
 
-struct IndexPacket
-{
-   static constexpr unsigned MAX_ENTRIES = 2048;
-
-   const uint8_t packetType = INDEX_PACKET;
-
-   uint8_t packetFlags = 0; // flag bitfields
-   uint16_t packetLogicalLengthMinus1 = 0;
-   uint16_t entryCount = 0;
-   uint8_t indexLevel = 0;
-   uint8_t reserved1[9] = {}; // must be zero
-
-   struct IndexPacketEntry
-   {
-      uint64_t chunkRecordNumber = 0;
-      uint64_t chunkPhysicalOffset = 0;
-   } entries[MAX_ENTRIES];
+constexpr unsigned IndexPacket::MAX_ENTRIES;
+constexpr unsigned IndexPacket::HeaderSize;
 
-   void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0, uint64_t fileSize = 0 ) const;
-
-#ifdef E57_DEBUG
-   void dump( int indent = 0, std::ostream &os = std::cout ) const;
-#endif
-};
+static_assert( sizeof( IndexPacket ) == IndexPacket::HeaderSize + IndexPacket::MAX_ENTRIES * 16,
+               "Unexpected size of IndexPacket" );
 
 struct EmptyPacketHeader
 {
@@ -72,18 +55,111 @@ struct EmptyPacketHeader
 #endif
 };
 
+/// Get the fields common to all packets (see EmptyPacketHeader) straight from the start of a packet's bytes.
+static uint8_t packetTypeOf( const char *packet )
+{
+   return static_cast<uint8_t>( packet[offsetof( EmptyPacketHeader, packetType )] );
+}
+
+static unsigned packetLengthOf( const char *packet )
+{
+   uint16_t packetLogicalLengthMinus1 = 0;
+
+   memcpy( &packetLogicalLengthMinus1, packet + offsetof( EmptyPacketHeader, packetLogicalLengthMinus1 ),
+           sizeof( packetLogicalLengthMinus1 ) );
+
+   return packetLogicalLengthMinus1 + 1U;
+}
+
+/// Read the packet at packetLogicalOffset into buffer (which must hold DATA_PACKET_MAX bytes), returning its length.
+/// The page holding the header is kept by the CheckedFile, so reading the body afterwards only fetches (and verifies)
+/// the pages after it, in one go. When reading packets in order the header's page came with the previous packet.
+static unsigned readPacketData( CheckedFile *cFile, uint64_t packetLogicalOffset, char *buffer )
+{
+   /// Read header of packet first to get length.  Use EmptyPacketHeader since
+   /// it has the fields common to all packets.
+   constexpr size_t headerSize = sizeof( EmptyPacketHeader );
+
+   cFile->readAt( packetLogicalOffset, buffer, headerSize );
+
+   /// Can't verify packet header here, because it is not really an
+   /// EmptyPacketHeader.
+   const unsigned packetLength = packetLengthOf( buffer );
+
+   /// Be paranoid about packetLength before read
+   if ( ( packetLength > DATA_PACKET_MAX ) || ( packetLength < headerSize ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString( packetLength ) );
+   }
+
+   /// Now read in the rest of the packet after the header
+   cFile->readAt( packetLogicalOffset + headerSize, buffer + headerSize, packetLength - headerSize );
+
+   return packetLength;
+}
+
 //=============================================================================
 // PacketReadCache
 
-PacketReadCache::PacketReadCache( CheckedFile *cFile, unsigned packetCount ) : cFile_( cFile ), entries_( packetCount )
+constexpr unsigned PacketReadCache::cNoEntry;
+
+PacketCacheBudget::PacketCacheBudget( size_t byteCount ) : byteCount_( byteCount )
+{
+}
+
+bool PacketCacheBudget::take( size_t byteCount, bool force )
+{
+   std::lock_guard<std::mutex> lock( mutex_ );
+
+   if ( !force && ( usedByteCount_ + byteCount > byteCount_ ) )
+   {
+      return false;
+   }
+
+   usedByteCount_ += byteCount;
+
+   return true;
+}
+
+void PacketCacheBudget::give( size_t byteCount )
+{
+   std::lock_guard<std::mutex> lock( mutex_ );
+
+   usedByteCount_ -= std::min( byteCount, usedByteCount_ );
+}
+
+PacketReadCache::PacketReadCache( CheckedFile *cFile, unsigned packetCount,
+                                  std::shared_ptr<PacketCacheBudget> budget ) :
+   cFile_( cFile ), budget_( std::move( budget ) ), entries_( packetCount )
 {
    if ( packetCount == 0 )
    {
       throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetCount=" + toString( packetCount ) );
    }
+
+   index_.reserve( packetCount );
+
+   /// Chain all the (unused) entries together, entry 0 is the first to be used
+   for ( unsigned i = 0; i < packetCount; ++i )
+   {
+      entries_[i].older_ = ( i > 0 ) ? i - 1 : cNoEntry;
+      entries_[i].newer_ = ( i + 1 < packetCount ) ? i + 1 : cNoEntry;
+   }
+
+   oldest_ = 0;
+   newest_ = packetCount - 1;
 }
 
-std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char *&pkt )
+PacketReadCache::~PacketReadCache()
+{
+   if ( budget_ )
+   {
+      budget_->give( static_cast<size_t>( bufferCount_ ) * DATA_PACKET_MAX );
+   }
+}
+
+std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset, char *&pkt,
+                                                   PacketReadAhead *readAhead )
 {
 #ifdef E57_MAX_VERBOSE
    std::cout << "PacketReadCache::lock() called, packetLogicalOffset=" << packetLogicalOffset << std::endl;
@@ -101,60 +177,37 @@ std::unique_ptr<PacketLock> PacketReadCache::lock( uint64_t packetLogicalOffset,
       throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetLogicalOffset=" + toString( packetLogicalOffset ) );
    }
 
-   /// Linear scan for matching packet offset in cache
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   unsigned entryIndex = cNoEntry;
+
+   const auto found = index_.find( packetLogicalOffset );
+
+   if ( found != index_.end() )
    {
-      auto &entry = entries_[i];
+      /// Found a match, so don't have to read anything
+      entryIndex = found->second;
 
-      if ( packetLogicalOffset == entry.logicalOffset_ )
-      {
-         /// Found a match, so don't have to read anything
 #ifdef E57_MAX_VERBOSE
-         std::cout << "  Found matching cache entry, index=" << i << std::endl;
+      std::cout << "  Found matching cache entry, index=" << entryIndex << std::endl;
 #endif
-         /// Mark entry with current useCount (keeps track of age of entry).
-         entry.lastUsed_ = ++useCount_;
-
-         /// Publish buffer address to caller
-         pkt = entry.buffer_;
-
-         /// Create lock so we are sure that we will be unlocked when use is
-         /// finished.
-         std::unique_ptr<PacketLock> plock( new PacketLock( this, i ) );
-
-         /// Increment cache lock just before return
-         ++lockCount_;
-
-         return plock;
-      }
    }
-   /// Get here if didn't find a match already in cache.
-
-   /// Find least recently used (LRU) packet buffer
-   unsigned oldestEntry = 0;
-   unsigned oldestUsed = entries_.at( 0 ).lastUsed_;
-
-   for ( unsigned i = 0; i < entries_.size(); ++i )
+   else
    {
-      const auto &entry = entries_[i];
+      entryIndex = entryToReuse();
 
-      if ( entry.lastUsed_ < oldestUsed )
-      {
-         oldestEntry = i;
-         oldestUsed = entry.lastUsed_;
-      }
-   }
 #ifdef E57_MAX_VERBOSE
-   std::cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << std::endl;
+      std::cout << "  Oldest entry=" << entryIndex << std::endl;
 #endif
 
-   readPacket( oldestEntry, packetLogicalOffset );
+      readPacket( entryIndex, packetLogicalOffset, readAhead );
+   }
+
+   touch( entryIndex );
 
    /// Publish buffer address to caller
-   pkt = entries_[oldestEntry].buffer_;
+   pkt = entries_[entryIndex].buffer_.data();
 
    /// Create lock so we are sure we will be unlocked when use is finished.
-   std::unique_ptr<PacketLock> plock( new PacketLock( this, oldestEntry ) );
+   std::unique_ptr<PacketLock> plock( new PacketLock( this, entryIndex ) );
 
    /// Increment cache lock just before return
    ++lockCount_;
@@ -177,42 +230,100 @@ void PacketReadCache::unlock( unsigned cacheIndex )
    --lockCount_;
 }
 
-void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset )
+unsigned PacketReadCache::entryToReuse()
+{
+   /// Reuse the least recently used (LRU) packet buffer. Unused entries are the oldest, so this only allocates
+   /// one once all the allocated ones are in use.
+   unsigned entryIndex = oldest_;
+
+   if ( !entries_[entryIndex].buffer_.empty() )
+   {
+      return entryIndex;
+   }
+
+   /// The first buffer doesn't need room in the budget, so every cache can hold a packet
+   if ( !budget_ || budget_->take( DATA_PACKET_MAX, bufferCount_ == 0 ) )
+   {
+      entries_[entryIndex].buffer_.resize( DATA_PACKET_MAX );
+      ++bufferCount_;
+
+      return entryIndex;
+   }
+
+   /// The other caches of the ImageFile are using the budget, so make do with the buffers we have
+   while ( entries_[entryIndex].buffer_.empty() )
+   {
+      entryIndex = entries_[entryIndex].newer_;
+   }
+
+   return entryIndex;
+}
+
+void PacketReadCache::touch( unsigned entryIndex )
+{
+   if ( entryIndex == newest_ )
+   {
+      return;
+   }
+
+   auto &entry = entries_[entryIndex];
+
+   /// Unlink (it can't be the newest, so it has a newer neighbour)
+   entries_[entry.newer_].older_ = entry.older_;
+
+   if ( entry.older_ != cNoEntry )
+   {
+      entries_[entry.older_].newer_ = entry.newer_;
+   }
+   else
+   {
+      oldest_ = entry.newer_;
+   }
+
+   /// Link in at the newest end
+   entry.newer_ = cNoEntry;
+   entry.older_ = newest_;
+
+   entries_[newest_].newer_ = entryIndex;
+   newest_ = entryIndex;
+}
+
+void PacketReadCache::readPacket( unsigned entryIndex, uint64_t packetLogicalOffset, PacketReadAhead *readAhead )
 {
 #ifdef E57_MAX_VERBOSE
-   std::cout << "PacketReadCache::readPacket() called, oldestEntry=" << oldestEntry
+   std::cout << "PacketReadCache::readPacket() called, entryIndex=" << entryIndex
              << " packetLogicalOffset=" << packetLogicalOffset << std::endl;
 #endif
 
-   /// Read header of packet first to get length.  Use EmptyPacketHeader since
-   /// it has the fields common to all packets.
-   EmptyPacketHeader header;
+   auto &entry = entries_.at( entryIndex );
 
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( reinterpret_cast<char *>( &header ), sizeof( header ) );
-
-   /// Can't verify packet header here, because it is not really an
-   /// EmptyPacketHeader.
-   unsigned packetLength = header.packetLogicalLengthMinus1 + 1;
-
-   /// Be paranoid about packetLength before read
-   if ( packetLength > DATA_PACKET_MAX )
+   /// Forget the old packet first so a failure below doesn't leave the entry looking valid
+   if ( entry.logicalOffset_ != 0 )
    {
-      throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString( packetLength ) );
+      index_.erase( entry.logicalOffset_ );
+      entry.logicalOffset_ = 0;
    }
 
-   auto &entry = entries_.at( oldestEntry );
+   if ( ( readAhead == nullptr ) || !readAhead->take( packetLogicalOffset, entry.buffer_ ) )
+   {
+      const unsigned packetLength = readPacketData( cFile_, packetLogicalOffset, entry.buffer_.data() );
+
+      /// Carry on reading from the packet after this one
+      if ( readAhead != nullptr )
+      {
+         readAhead->start( packetLogicalOffset + packetLength );
+      }
+   }
 
-   /// Now read in whole packet into preallocated buffer_.  Note buffer is
-   cFile_->seek( packetLogicalOffset, CheckedFile::Logical );
-   cFile_->read( entry.buffer_, packetLength );
+   const uint8_t packetType = packetTypeOf( entry.buffer_.data() );
+   const unsigned packetLength = packetLengthOf( entry.buffer_.data() );
 
    /// Verify that packet is good.
-   switch ( header.packetType )
+   switch ( packetType )
    {
       case DATA_PACKET:
       {
-         auto dpkt = reinterpret_cast<DataPacket *>( entry.buffer_ );
+         auto dpkt = reinterpret_cast<DataPacket *>( entry.buffer_.data() );
 
          dpkt->verify( packetLength );
 #ifdef E57_MAX_VERBOSE
@@ -223,7 +334,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       break;
       case INDEX_PACKET:
       {
-         auto ipkt = reinterpret_cast<IndexPacket *>( entry.buffer_ );
+         auto ipkt = reinterpret_cast<IndexPacket *>( entry.buffer_.data() );
 
          ipkt->verify( packetLength );
 #ifdef E57_MAX_VERBOSE
@@ -234,7 +345,7 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       break;
       case EMPTY_PACKET:
       {
-         auto hp = reinterpret_cast<EmptyPacketHeader *>( entry.buffer_ );
+         auto hp = reinterpret_cast<EmptyPacketHeader *>( entry.buffer_.data() );
 
          hp->verify( packetLength );
 #ifdef E57_MAX_VERBOSE
@@ -244,47 +355,47 @@ void PacketReadCache::readPacket( unsigned oldestEntry, uint64_t packetLogicalOf
       }
       break;
       default:
-         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetType=" + toString( header.packetType ) );
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "packetType=" + toString( packetType ) );
    }
 
    entry.logicalOffset_ = packetLogicalOffset;
 
-   /// Mark entry with current useCount (keeps track of age of entry).
-   /// This is a cache, so a small hiccup when useCount_ overflows won't hurt.
-   entry.lastUsed_ = ++useCount_;
+   index_[packetLogicalOffset] = entryIndex;
 }
 
 #ifdef E57_DEBUG
 void PacketReadCache::dump( int indent, std::ostream &os )
 {
    os << space( indent ) << "lockCount: " << lockCount_ << std::endl;
-   os << space( indent ) << "useCount:  " << useCount_ << std::endl;
+   os << space( indent ) << "newest:    " << newest_ << std::endl;
+   os << space( indent ) << "oldest:    " << oldest_ << std::endl;
    os << space( indent ) << "entries:" << std::endl;
    for ( unsigned i = 0; i < entries_.size(); i++ )
    {
       os << space( indent ) << "entry[" << i << "]:" << std::endl;
       os << space( indent + 4 ) << "logicalOffset:  " << entries_[i].logicalOffset_ << std::endl;
-      os << space( indent + 4 ) << "lastUsed:        " << entries_[i].lastUsed_ << std::endl;
+      os << space( indent + 4 ) << "newer:          " << entries_[i].newer_ << std::endl;
+      os << space( indent + 4 ) << "older:          " << entries_[i].older_ << std::endl;
       if ( entries_[i].logicalOffset_ != 0 )
       {
          os << space( indent + 4 ) << "packet:" << std::endl;
-         switch ( reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_ )->packetType )
+         switch ( reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_.data() )->packetType )
          {
             case DATA_PACKET:
             {
-               auto dpkt = reinterpret_cast<DataPacket *>( entries_.at( i ).buffer_ );
+               auto dpkt = reinterpret_cast<DataPacket *>( entries_.at( i ).buffer_.data() );
                dpkt->dump( indent + 6, os );
             }
             break;
             case INDEX_PACKET:
             {
-               auto ipkt = reinterpret_cast<IndexPacket *>( entries_.at( i ).buffer_ );
+               auto ipkt = reinterpret_cast<IndexPacket *>( entries_.at( i ).buffer_.data() );
                ipkt->dump( indent + 6, os );
             }
             break;
             case EMPTY_PACKET:
             {
-               auto hp = reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_ );
+               auto hp = reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_.data() );
                hp->dump( indent + 6, os );
             }
             break;
@@ -292,7 +403,7 @@ void PacketReadCache::dump( int indent, std::ostream &os )
                throw E57_EXCEPTION2(
                   E57_ERROR_INTERNAL,
                   "packetType=" +
-                     toString( reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_ )->packetType ) );
+                     toString( reinterpret_cast<EmptyPacketHeader *>( entries_.at( i ).buffer_.data() )->packetType ) );
          }
       }
    }
@@ -302,6 +413,346 @@ void PacketReadCache::dump( int indent, std::ostream &os )
 //=============================================================================
 // PacketLock
 
+//================================================================
+
+PacketReadAhead::PacketReadAhead( CheckedFile *cFile, uint64_t sectionEndLogicalOffset, unsigned depth ) :
+   cFile_( cFile ), sectionEndLogicalOffset_( sectionEndLogicalOffset ), depth_( std::max( depth, 1U ) ),
+   nextLogicalOffset_( sectionEndLogicalOffset )
+{
+   thread_ = std::thread( &PacketReadAhead::run, this );
+}
+
+PacketReadAhead::~PacketReadAhead()
+{
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+      stopping_ = true;
+   }
+
+   workAvailable_.notify_one();
+
+   thread_.join();
+}
+
+void PacketReadAhead::start( uint64_t packetLogicalOffset )
+{
+#ifdef E57_MAX_VERBOSE
+   std::cout << "PacketReadAhead::start() called, packetLogicalOffset=" << packetLogicalOffset << std::endl;
+#endif
+
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      for ( auto &entry : ready_ )
+      {
+         freeBuffers_.push_back( std::move( entry.buffer_ ) );
+      }
+
+      ready_.clear();
+
+      nextLogicalOffset_ = std::min( packetLogicalOffset, sectionEndLogicalOffset_ );
+      ++generation_;
+   }
+
+   workAvailable_.notify_one();
+}
+
+bool PacketReadAhead::take( uint64_t packetLogicalOffset, std::vector<char> &buffer )
+{
+   std::unique_lock<std::mutex> lock( mutex_ );
+
+   while ( true )
+   {
+      /// Anything before the packet we want has been skipped
+      while ( !ready_.empty() && ( ready_.front().logicalOffset_ < packetLogicalOffset ) )
+      {
+         freeBuffers_.push_back( std::move( ready_.front().buffer_ ) );
+         ready_.pop_front();
+      }
+
+      if ( !ready_.empty() && ( ready_.front().logicalOffset_ == packetLogicalOffset ) )
+      {
+         std::swap( buffer, ready_.front().buffer_ );
+
+         freeBuffers_.push_back( std::move( ready_.front().buffer_ ) );
+         ready_.pop_front();
+
+         /// There's room for another one now
+         workAvailable_.notify_one();
+
+         return true;
+      }
+
+      /// Wait if it's being read now, or it's next in line
+      const bool coming = ( readingLogicalOffset_ == packetLogicalOffset ) ||
+                          ( ready_.empty() && ( nextLogicalOffset_ == packetLogicalOffset ) &&
+                            ( packetLogicalOffset < sectionEndLogicalOffset_ ) );
+
+      if ( !coming )
+      {
+         return false;
+      }
+
+      workAvailable_.notify_one();
+      workDone_.wait( lock );
+   }
+}
+
+void PacketReadAhead::run()
+{
+   std::unique_lock<std::mutex> lock( mutex_ );
+
+   while ( true )
+   {
+      workAvailable_.wait( lock, [this] {
+         return stopping_ || ( ( nextLogicalOffset_ < sectionEndLogicalOffset_ ) && ( ready_.size() < depth_ ) );
+      } );
+
+      if ( stopping_ )
+      {
+         return;
+      }
+
+      Entry entry;
+      entry.logicalOffset_ = nextLogicalOffset_;
+
+      if ( !freeBuffers_.empty() )
+      {
+         entry.buffer_ = std::move( freeBuffers_.back() );
+         freeBuffers_.pop_back();
+      }
+
+      readingLogicalOffset_ = entry.logicalOffset_;
+
+      const unsigned generation = generation_;
+
+      lock.unlock();
+
+      unsigned packetLength = 0;
+
+      try
+      {
+         if ( entry.buffer_.size() < DATA_PACKET_MAX )
+         {
+            entry.buffer_.resize( DATA_PACKET_MAX );
+         }
+
+         packetLength = readPacketData( cFile_, entry.logicalOffset_, entry.buffer_.data() );
+      }
+      catch ( ... )
+      {
+         /// Leave it for the caller to read & report
+         packetLength = 0;
+      }
+
+      lock.lock();
+
+      readingLogicalOffset_ = 0;
+
+      if ( generation != generation_ )
+      {
+         /// start() moved us somewhere else while we were reading
+         freeBuffers_.push_back( std::move( entry.buffer_ ) );
+      }
+      else if ( packetLength == 0 )
+      {
+         freeBuffers_.push_back( std::move( entry.buffer_ ) );
+
+         nextLogicalOffset_ = sectionEndLogicalOffset_;
+      }
+      else
+      {
+         nextLogicalOffset_ = entry.logicalOffset_ + packetLength;
+
+         ready_.push_back( std::move( entry ) );
+      }
+
+      workDone_.notify_all();
+   }
+}
+
+//================================================================
+
+PacketWriteQueue::PacketWriteQueue( CheckedFile *cFile, unsigned maxQueued ) :
+   cFile_( cFile ), maxQueued_( std::max( maxQueued, 1U ) )
+{
+   thread_ = std::thread( &PacketWriteQueue::run, this );
+}
+
+PacketWriteQueue::~PacketWriteQueue()
+{
+   /// Let the thread finish what it has been given before it stops
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+      stopping_ = true;
+   }
+
+   workAvailable_.notify_one();
+
+   thread_.join();
+}
+
+void PacketWriteQueue::write( uint64_t packetLogicalOffset, const char *packet, size_t packetLength )
+{
+#ifdef E57_MAX_VERBOSE
+   std::cout << "PacketWriteQueue::write() called, packetLogicalOffset=" << packetLogicalOffset
+             << " packetLength=" << packetLength << std::endl;
+#endif
+
+   Entry entry;
+   entry.logicalOffset_ = packetLogicalOffset;
+
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      /// Back-pressure: wait for room in the queue
+      workDone_.wait( lock, [this] { return error_ || ( queue_.size() < maxQueued_ ); } );
+
+      if ( error_ )
+      {
+         std::rethrow_exception( error_ );
+      }
+
+      if ( !freeBuffers_.empty() )
+      {
+         entry.buffer_ = std::move( freeBuffers_.back() );
+         freeBuffers_.pop_back();
+      }
+   }
+
+   entry.buffer_.assign( packet, packet + packetLength );
+
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+      queue_.push_back( std::move( entry ) );
+   }
+
+   workAvailable_.notify_one();
+}
+
+void PacketWriteQueue::flush()
+{
+   std::unique_lock<std::mutex> lock( mutex_ );
+
+   workDone_.wait( lock, [this] { return error_ || ( queue_.empty() && !writing_ ); } );
+
+   if ( error_ )
+   {
+      std::rethrow_exception( error_ );
+   }
+}
+
+void PacketWriteQueue::run()
+{
+   std::unique_lock<std::mutex> lock( mutex_ );
+
+   while ( true )
+   {
+      workAvailable_.wait( lock, [this] { return stopping_ || !queue_.empty(); } );
+
+      if ( queue_.empty() )
+      {
+         /// stopping_ and nothing left to do
+         return;
+      }
+
+      Entry entry = std::move( queue_.front() );
+      queue_.pop_front();
+
+      writing_ = true;
+
+      /// Once something has failed, don't write anything else
+      const bool skip = static_cast<bool>( error_ );
+
+      lock.unlock();
+
+      std::exception_ptr error;
+
+      if ( !skip )
+      {
+         try
+         {
+            cFile_->writeAt( entry.logicalOffset_, entry.buffer_.data(), entry.buffer_.size() );
+         }
+         catch ( ... )
+         {
+            error = std::current_exception();
+         }
+      }
+
+      lock.lock();
+
+      if ( error )
+      {
+         error_ = error;
+      }
+
+      writing_ = false;
+      freeBuffers_.push_back( std::move( entry.buffer_ ) );
+
+      workDone_.notify_all();
+   }
+}
+
+//================================================================
+// PacketSpill
+
+PacketSpill::PacketSpill() : file_( std::tmpfile() )
+{
+   if ( file_ == nullptr )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_OPEN_FAILED, "temporary spill file" );
+   }
+}
+
+PacketSpill::~PacketSpill()
+{
+   /// The temporary file is removed when it is closed
+   std::fclose( file_ );
+}
+
+uint64_t PacketSpill::write( const char *packet, size_t packetLength )
+{
+   if ( std::fwrite( packet, 1, packetLength, file_ ) != packetLength )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_WRITE_FAILED, "temporary spill file, length=" + toString( length_ ) );
+   }
+
+   const uint64_t offset = length_;
+
+   length_ += packetLength;
+
+   return offset;
+}
+
+void PacketSpill::copyTo( CheckedFile *cFile, uint64_t logicalOffset )
+{
+#ifdef E57_MAX_VERBOSE
+   std::cout << "PacketSpill::copyTo() called, logicalOffset=" << logicalOffset << " length=" << length_
+             << std::endl;
+#endif
+   std::rewind( file_ );
+
+   std::vector<char> buffer( DATA_PACKET_MAX );
+
+   for ( uint64_t copied = 0; copied < length_; )
+   {
+      const auto n = static_cast<size_t>( std::min<uint64_t>( buffer.size(), length_ - copied ) );
+
+      if ( std::fread( buffer.data(), 1, n, file_ ) != n )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_READ_FAILED, "temporary spill file, offset=" + toString( copied ) +
+                                                         " length=" + toString( length_ ) );
+      }
+
+      cFile->writeAt( logicalOffset + copied, buffer.data(), n );
+
+      copied += n;
+   }
+}
+
+//================================================================
+
 PacketLock::PacketLock( PacketReadCache *cache, unsigned cacheIndex ) : cache_( cache ), cacheIndex_( cacheIndex )
 {
 #ifdef E57_MAX_VERBOSE
@@ -556,7 +1007,7 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount, uint
 
    /// Check packetLength is at least large enough to hold header
    unsigned packetLength = packetLogicalLengthMinus1 + 1;
-   if ( packetLength < sizeof( *this ) )
+   if ( packetLength < HeaderSize )
    {
       throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString( packetLength ) );
    }
@@ -614,7 +1065,7 @@ void IndexPacket::verify( unsigned bufferLength, uint64_t totalRecordCount, uint
    }
 
    /// Check if entries will fit in space provided
-   unsigned neededLength = 16 + 8 * entryCount;
+   unsigned neededLength = HeaderSize + sizeof( IndexPacketEntry ) * entryCount;
    if ( packetLength < neededLength )
    {
       throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET,
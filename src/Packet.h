@@ -27,7 +27,15 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "Common.h"
@@ -36,6 +44,7 @@ namespace e57
 {
    class CheckedFile;
    class PacketLock;
+   class PacketReadAhead;
 
    /// Packet types (in a compressed vector section)
    enum
@@ -48,13 +57,38 @@ namespace e57
    /// maximum size of CompressedVector binary data packet
    constexpr int DATA_PACKET_MAX = ( 64 * 1024 );
 
+   /// The bytes of packet buffers that the caches of one ImageFile may allocate between them.
+   class PacketCacheBudget
+   {
+   public:
+      explicit PacketCacheBudget( size_t byteCount );
+
+      /// Returns false (& takes nothing) if there isn't room for byteCount more, unless force is set
+      bool take( size_t byteCount, bool force = false );
+      void give( size_t byteCount );
+
+   private:
+      std::mutex mutex_;
+      size_t byteCount_;
+      size_t usedByteCount_ = 0;
+   };
+
+   /// Holds recently used packets so they don't have to be read again.
+   /// Entries are found by logical offset using a hash map, and kept in least-recently-used order using a
+   /// doubly linked list threaded through the entries themselves.
    class PacketReadCache
    {
    public:
-      PacketReadCache( CheckedFile *cFile, unsigned packetCount );
+      /// If budget is given, packet buffers other than the first are only allocated while there's room in it.
+      PacketReadCache( CheckedFile *cFile, unsigned packetCount, std::shared_ptr<PacketCacheBudget> budget = nullptr );
+      ~PacketReadCache();
+
+      PacketReadCache( const PacketReadCache & ) = delete;
+      PacketReadCache &operator=( const PacketReadCache & ) = delete;
 
-      std::unique_ptr<PacketLock> lock( uint64_t packetLogicalOffset,
-                                        char *&pkt ); //??? pkt could be const
+      /// If readAhead is given, it is asked for packets before reading them from the file.
+      std::unique_ptr<PacketLock> lock( uint64_t packetLogicalOffset, char *&pkt,
+                                        PacketReadAhead *readAhead = nullptr ); //??? pkt could be const
 
 #ifdef E57_DEBUG
       void dump( int indent = 0, std::ostream &os = std::cout );
@@ -65,20 +99,152 @@ namespace e57
       friend class PacketLock;
       void unlock( unsigned cacheIndex );
 
-      void readPacket( unsigned oldestEntry, uint64_t packetLogicalOffset );
+      /// The entry to read a packet into, with its buffer allocated
+      unsigned entryToReuse();
+
+      void readPacket( unsigned entryIndex, uint64_t packetLogicalOffset, PacketReadAhead *readAhead );
+
+      /// Move entry to the most recently used end of the list
+      void touch( unsigned entryIndex );
+
+      /// Marks the ends of the LRU list
+      static constexpr unsigned cNoEntry = std::numeric_limits<unsigned>::max();
 
       struct CacheEntry
       {
-         uint64_t logicalOffset_ = 0;
-         char buffer_[DATA_PACKET_MAX]; //! No need to init since it's a data buffer
-         unsigned lastUsed_ = 0;
+         uint64_t logicalOffset_ = 0; /// 0 if unused
+         std::vector<char> buffer_;   /// allocated (DATA_PACKET_MAX) when first used
+         unsigned newer_ = cNoEntry;
+         unsigned older_ = cNoEntry;
       };
 
       unsigned lockCount_ = 0;
-      unsigned useCount_ = 0;
       CheckedFile *cFile_ = nullptr;
+      std::shared_ptr<PacketCacheBudget> budget_;
+      unsigned bufferCount_ = 0; /// entries with a buffer allocated
 
       std::vector<CacheEntry> entries_;
+      std::unordered_map<uint64_t, unsigned> index_; /// logical offset -> entry
+
+      unsigned newest_ = cNoEntry;
+      unsigned oldest_ = cNoEntry;
+   };
+
+   /// Reads & verifies the packets following the one being decoded on a background thread, so the I/O overlaps
+   /// decoding. Packets are read sequentially up to the end of the section, at most depth at a time.
+   /// Errors stop the read-ahead; they are reported when the packet is read again by the caller.
+   class PacketReadAhead
+   {
+   public:
+      PacketReadAhead( CheckedFile *cFile, uint64_t sectionEndLogicalOffset, unsigned depth );
+      ~PacketReadAhead();
+
+      PacketReadAhead( const PacketReadAhead & ) = delete;
+      PacketReadAhead &operator=( const PacketReadAhead & ) = delete;
+
+      /// Start reading ahead from packetLogicalOffset, dropping anything read from elsewhere
+      void start( uint64_t packetLogicalOffset );
+
+      /// If the packet at packetLogicalOffset has been (or is being) read ahead, swap its contents into buffer &
+      /// return true. Returns false if it isn't coming, in which case the caller has to read it.
+      bool take( uint64_t packetLogicalOffset, std::vector<char> &buffer );
+
+   private:
+      struct Entry
+      {
+         uint64_t logicalOffset_ = 0;
+         std::vector<char> buffer_;
+      };
+
+      void run();
+
+      CheckedFile *cFile_ = nullptr;
+      const uint64_t sectionEndLogicalOffset_;
+      const unsigned depth_;
+
+      std::mutex mutex_;
+      std::condition_variable workAvailable_;
+      std::condition_variable workDone_;
+
+      std::deque<Entry> ready_;
+      std::vector<std::vector<char>> freeBuffers_;
+
+      uint64_t nextLogicalOffset_;        /// next packet to read, sectionEndLogicalOffset_ when there are no more
+      uint64_t readingLogicalOffset_ = 0; /// packet being read now, 0 if none
+      unsigned generation_ = 0;           /// changed by start() so a read in progress is dropped
+      bool stopping_ = false;
+
+      std::thread thread_;
+   };
+
+   /// Writes packets to the file on a background thread so the caller can carry on preparing the next ones.
+   /// At most maxQueued packets wait to be written, write() blocks while the queue is full.
+   /// An error on the background thread is rethrown from the next write() or flush().
+   class PacketWriteQueue
+   {
+   public:
+      PacketWriteQueue( CheckedFile *cFile, unsigned maxQueued );
+      ~PacketWriteQueue();
+
+      PacketWriteQueue( const PacketWriteQueue & ) = delete;
+      PacketWriteQueue &operator=( const PacketWriteQueue & ) = delete;
+
+      /// Copy the packet & queue it to be written at packetLogicalOffset
+      void write( uint64_t packetLogicalOffset, const char *packet, size_t packetLength );
+
+      /// Wait until everything queued has been written
+      void flush();
+
+   private:
+      struct Entry
+      {
+         uint64_t logicalOffset_ = 0;
+         std::vector<char> buffer_;
+      };
+
+      void run();
+
+      CheckedFile *cFile_ = nullptr;
+      const unsigned maxQueued_;
+
+      std::mutex mutex_;
+      std::condition_variable workAvailable_;
+      std::condition_variable workDone_;
+
+      std::deque<Entry> queue_;
+      std::vector<std::vector<char>> freeBuffers_; /// reuse buffers instead of allocating for every packet
+      bool writing_ = false;
+      bool stopping_ = false;
+      std::exception_ptr error_;
+
+      std::thread thread_;
+   };
+
+   /// Holds the data packets of a compressed vector section in a temporary file while another writer is appending
+   /// to the ImageFile, until they can be copied to the end of it in one go.
+   class PacketSpill
+   {
+   public:
+      PacketSpill();
+      ~PacketSpill();
+
+      PacketSpill( const PacketSpill & ) = delete;
+      PacketSpill &operator=( const PacketSpill & ) = delete;
+
+      /// Append a packet, returning its offset from the start of the spill
+      uint64_t write( const char *packet, size_t packetLength );
+
+      uint64_t length() const
+      {
+         return length_;
+      }
+
+      /// Copy everything to cFile, starting at logicalOffset
+      void copyTo( CheckedFile *cFile, uint64_t logicalOffset );
+
+   private:
+      std::FILE *file_ = nullptr;
+      uint64_t length_ = 0;
    };
 
    class PacketLock
@@ -138,4 +304,32 @@ namespace e57
 
       uint8_t payload[PayloadSize]; //! No need to init since it's a data buffer
    };
+
+   struct IndexPacket
+   {
+      static constexpr unsigned MAX_ENTRIES = 2048;
+
+      /// Size of the fields before the entries
+      static constexpr unsigned HeaderSize = 16;
+
+      const uint8_t packetType = INDEX_PACKET;
+
+      uint8_t packetFlags = 0; // flag bitfields
+      uint16_t packetLogicalLengthMinus1 = 0;
+      uint16_t entryCount = 0;
+      uint8_t indexLevel = 0;
+      uint8_t reserved1[9] = {}; // must be zero
+
+      struct IndexPacketEntry
+      {
+         uint64_t chunkRecordNumber = 0;
+         uint64_t chunkPhysicalOffset = 0;
+      } entries[MAX_ENTRIES];
+
+      void verify( unsigned bufferLength = 0, uint64_t totalRecordCount = 0, uint64_t fileSize = 0 ) const;
+
+#ifdef E57_DEBUG
+      void dump( int indent = 0, std::ostream &os = std::cout ) const;
+#endif
+   };
 }
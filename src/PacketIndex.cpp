@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <algorithm>
+#include <cstring>
+
+#include "CheckedFile.h"
+#include "Packet.h"
+#include "PacketIndex.h"
+#include "StringFunctions.h"
+
+namespace
+{
+   /// The sidecar file is written with the same checksummed pages as E57 files, so damage is detected when reading.
+   /// It starts with this header, followed by the GUID & then each section.
+   struct SidecarHeader
+   {
+      char signature[8] = { 'E', '5', '7', 'P', 'K', 'I', 'D', 'X' };
+      uint32_t version = 1;
+      uint32_t guidLength = 0;
+      uint64_t fileSize = 0;
+      int64_t modificationTime = 0;
+      uint64_t sectionCount = 0;
+   };
+
+   /// Each section is followed by its packet logical offsets (uint64_t), then the buffer lengths (uint16_t) of each
+   /// bytestream in each packet, one bytestream at a time.
+   struct SidecarSection
+   {
+      uint64_t sectionLogicalStart = 0;
+      uint64_t packetCount = 0;
+      uint32_t bytestreamCount = 0;
+      uint32_t reserved = 0;
+   };
+
+   constexpr size_t SidecarPacketSize = sizeof( uint64_t );
+   constexpr size_t SidecarBufferLengthSize = sizeof( uint16_t );
+}
+
+namespace e57
+{
+   PacketIndex::PacketIndex( CheckedFile *file, uint64_t dataLogicalOffset, uint64_t sectionEndLogicalOffset )
+   {
+#ifdef E57_MAX_VERBOSE
+      std::cout << "PacketIndex() called, dataLogicalOffset=" << dataLogicalOffset
+                << " sectionEndLogicalOffset=" << sectionEndLogicalOffset << std::endl;
+#endif
+      std::vector<uint16_t> bufferLengths;
+
+      uint64_t packetLogicalOffset = dataLogicalOffset;
+
+      while ( packetLogicalOffset < sectionEndLogicalOffset )
+      {
+         /// Only read the header & the bytestream buffer lengths which follow it, not the whole packet
+         DataPacketHeader header;
+
+         file->readAt( packetLogicalOffset, reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         const unsigned packetLength = header.packetLogicalLengthMinus1 + 1;
+
+         if ( header.packetType == DATA_PACKET )
+         {
+            header.verify( DATA_PACKET_MAX );
+
+            if ( bytestreamOffsets_.empty() )
+            {
+               bytestreamCount_ = header.bytestreamCount;
+               bytestreamOffsets_.assign( bytestreamCount_, std::vector<uint64_t>( 1, 0 ) );
+            }
+            else if ( header.bytestreamCount != bytestreamCount_ )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "bytestreamCount=" + toString( header.bytestreamCount ) +
+                                                                 " expected=" + toString( bytestreamCount_ ) );
+            }
+
+            bufferLengths.resize( bytestreamCount_ );
+
+            file->readAt( packetLogicalOffset + sizeof( header ), reinterpret_cast<char *>( bufferLengths.data() ),
+                          bytestreamCount_ * sizeof( uint16_t ) );
+
+            /// Double check the buffers fit in the packet
+            size_t totalLength = sizeof( header ) + bytestreamCount_ * sizeof( uint16_t );
+            for ( const uint16_t length : bufferLengths )
+            {
+               totalLength += length;
+            }
+
+            if ( totalLength > packetLength )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString( packetLength ) +
+                                                                 " totalLength=" + toString( totalLength ) );
+            }
+
+            packetLogicalOffsets_.push_back( packetLogicalOffset );
+
+            for ( unsigned i = 0; i < bytestreamCount_; ++i )
+            {
+               bytestreamOffsets_[i].push_back( bytestreamOffsets_[i].back() + bufferLengths[i] );
+            }
+         }
+         else if ( ( header.packetType != INDEX_PACKET ) && ( header.packetType != EMPTY_PACKET ) )
+         {
+            throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "packetType=" + toString( header.packetType ) );
+         }
+
+         packetLogicalOffset += packetLength;
+      }
+
+      if ( packetLogicalOffsets_.empty() )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_BAD_CV_PACKET, "dataLogicalOffset=" + toString( dataLogicalOffset ) );
+      }
+   }
+
+   uint64_t PacketIndex::findPacket( unsigned bytestreamNumber, uint64_t &byteOffset, size_t &bufferLength ) const
+   {
+      if ( bytestreamNumber >= bytestreamCount_ )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "bytestreamNumber=" + toString( bytestreamNumber ) +
+                                                      " bytestreamCount=" + toString( bytestreamCount_ ) );
+      }
+
+      const std::vector<uint64_t> &offsets = bytestreamOffsets_[bytestreamNumber];
+
+      /// Find the last packet which starts at or before the byte. This skips packets with nothing from this
+      /// bytestream in them.
+      const auto found = std::upper_bound( offsets.begin(), offsets.end() - 1, byteOffset );
+      const size_t packet = static_cast<size_t>( found - offsets.begin() ) - 1;
+
+      byteOffset -= offsets[packet];
+      bufferLength = static_cast<size_t>( offsets[packet + 1] - offsets[packet] );
+
+      return packetLogicalOffsets_[packet];
+   }
+
+   PacketIndexFile::PacketIndexFile( const ustring &path, const Key &key ) : path_( path ), key_( key )
+   {
+      if ( !path_.empty() )
+      {
+         load();
+      }
+   }
+
+   const PacketIndex *PacketIndexFile::find( uint64_t sectionLogicalStart ) const
+   {
+      std::lock_guard<std::mutex> lock( mutex_ );
+
+      const auto found = indexes_.find( sectionLogicalStart );
+
+      return ( found != indexes_.end() ) ? found->second.get() : nullptr;
+   }
+
+   const PacketIndex *PacketIndexFile::add( uint64_t sectionLogicalStart, std::unique_ptr<PacketIndex> index )
+   {
+      const PacketIndex *added = index.get();
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         auto &entry = indexes_[sectionLogicalStart];
+
+         if ( entry )
+         {
+            return entry.get();
+         }
+
+         entry = std::move( index );
+      }
+
+      if ( !path_.empty() )
+      {
+         save();
+      }
+
+      return added;
+   }
+
+   void PacketIndexFile::load()
+   {
+      /// Anything wrong with the sidecar just means we have to scan again
+      try
+      {
+         CheckedFile file( path_, CheckedFile::ReadOnly, ChecksumPolicy::All );
+
+         const uint64_t fileLength = file.length( CheckedFile::Logical );
+
+         SidecarHeader header;
+         const SidecarHeader expected;
+
+         file.read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+
+         if ( ( memcmp( header.signature, expected.signature, sizeof( header.signature ) ) != 0 ) ||
+              ( header.version != expected.version ) || ( header.fileSize != key_.fileSize ) ||
+              ( header.modificationTime != key_.modificationTime ) || ( header.guidLength != key_.guid.length() ) )
+         {
+            return;
+         }
+
+         ustring guid( header.guidLength, '\0' );
+         file.read( &guid[0], guid.length() );
+
+         if ( guid != key_.guid )
+         {
+            return;
+         }
+
+         for ( uint64_t i = 0; i < header.sectionCount; ++i )
+         {
+            SidecarSection section;
+
+            file.read( reinterpret_cast<char *>( &section ), sizeof( section ) );
+
+            const uint64_t remainingLength = fileLength - file.position();
+
+            if ( ( section.packetCount == 0 ) || ( section.bytestreamCount == 0 ) ||
+                 ( section.packetCount > remainingLength ) || ( section.bytestreamCount > remainingLength ) ||
+                 ( section.packetCount * ( SidecarPacketSize + section.bytestreamCount * SidecarBufferLengthSize ) >
+                   remainingLength ) )
+            {
+               indexes_.clear();
+               return;
+            }
+
+            std::unique_ptr<PacketIndex> index( new PacketIndex );
+
+            index->bytestreamCount_ = section.bytestreamCount;
+            index->packetLogicalOffsets_.resize( static_cast<size_t>( section.packetCount ) );
+
+            file.read( reinterpret_cast<char *>( index->packetLogicalOffsets_.data() ),
+                       index->packetLogicalOffsets_.size() * SidecarPacketSize );
+
+            std::vector<uint16_t> bufferLengths( static_cast<size_t>( section.packetCount ) );
+
+            index->bytestreamOffsets_.resize( section.bytestreamCount );
+
+            for ( auto &offsets : index->bytestreamOffsets_ )
+            {
+               file.read( reinterpret_cast<char *>( bufferLengths.data() ),
+                          bufferLengths.size() * SidecarBufferLengthSize );
+
+               offsets.reserve( bufferLengths.size() + 1 );
+               offsets.push_back( 0 );
+
+               for ( const uint16_t length : bufferLengths )
+               {
+                  offsets.push_back( offsets.back() + length );
+               }
+            }
+
+            indexes_[section.sectionLogicalStart] = std::move( index );
+         }
+
+#ifdef E57_MAX_VERBOSE
+         std::cout << "PacketIndexFile: loaded " << indexes_.size() << " section(s) from " << path_ << std::endl;
+#endif
+      }
+      catch ( E57Exception & )
+      {
+         indexes_.clear();
+      }
+   }
+
+   void PacketIndexFile::save() const
+   {
+      std::lock_guard<std::mutex> saveLock( saveMutex_ );
+
+      /// Take the indexes we have now & write them without holding up find() or add()
+      std::vector<std::pair<uint64_t, const PacketIndex *>> indexes;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         for ( const auto &entry : indexes_ )
+         {
+            indexes.emplace_back( entry.first, entry.second.get() );
+         }
+      }
+
+      /// The sidecar is only a cache, so failing to write it isn't an error
+      try
+      {
+         CheckedFile file( path_, CheckedFile::WriteCreate, ChecksumPolicy::All );
+
+         SidecarHeader header;
+         header.guidLength = static_cast<uint32_t>( key_.guid.length() );
+         header.fileSize = key_.fileSize;
+         header.modificationTime = key_.modificationTime;
+         header.sectionCount = indexes.size();
+
+         file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+         file.write( key_.guid.data(), key_.guid.length() );
+
+         std::vector<uint16_t> bufferLengths;
+
+         for ( const auto &entry : indexes )
+         {
+            const PacketIndex &index = *entry.second;
+
+            SidecarSection section;
+            section.sectionLogicalStart = entry.first;
+            section.packetCount = index.packetLogicalOffsets_.size();
+            section.bytestreamCount = index.bytestreamCount_;
+
+            file.write( reinterpret_cast<const char *>( &section ), sizeof( section ) );
+            file.write( reinterpret_cast<const char *>( index.packetLogicalOffsets_.data() ),
+                        index.packetLogicalOffsets_.size() * SidecarPacketSize );
+
+            bufferLengths.resize( index.packetLogicalOffsets_.size() );
+
+            for ( const auto &offsets : index.bytestreamOffsets_ )
+            {
+               for ( size_t i = 0; i < bufferLengths.size(); ++i )
+               {
+                  bufferLengths[i] = static_cast<uint16_t>( offsets[i + 1] - offsets[i] );
+               }
+
+               file.write( reinterpret_cast<const char *>( bufferLengths.data() ),
+                           bufferLengths.size() * SidecarBufferLengthSize );
+            }
+         }
+
+         file.close();
+
+#ifdef E57_MAX_VERBOSE
+         std::cout << "PacketIndexFile: saved " << indexes.size() << " section(s) to " << path_ << std::endl;
+#endif
+      }
+      catch ( E57Exception &ex )
+      {
+#ifdef E57_MAX_VERBOSE
+         std::cout << "PacketIndexFile: couldn't save to " << path_ << ": " << ex.what() << std::endl;
+#else
+         (void)ex;
+#endif
+      }
+   }
+}
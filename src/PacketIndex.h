@@ -0,0 +1,84 @@
+#pragma once
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Common.h"
+
+namespace e57
+{
+   class CheckedFile;
+
+   /// Where the data packets of a compressed vector section are & how much of each bytestream comes before each one.
+   /// This lets a reader find the packet holding any byte of a bytestream (and so any record of a fixed size) in
+   /// sections written without index packets. It is built by scanning the packet headers, without decoding anything.
+   class PacketIndex
+   {
+   public:
+      PacketIndex( CheckedFile *file, uint64_t dataLogicalOffset, uint64_t sectionEndLogicalOffset );
+
+      size_t packetCount() const
+      {
+         return packetLogicalOffsets_.size();
+      }
+
+      /// Find the packet holding byteOffset of a bytestream. Returns the packet's logical offset & sets byteOffset
+      /// to the offset in the packet's buffer for that bytestream, and bufferLength to the buffer's length.
+      uint64_t findPacket( unsigned bytestreamNumber, uint64_t &byteOffset, size_t &bufferLength ) const;
+
+   private:
+      friend class PacketIndexFile;
+
+      PacketIndex() = default;
+
+      unsigned bytestreamCount_ = 0;
+
+      std::vector<uint64_t> packetLogicalOffsets_;
+
+      /// [bytestream][packet] number of bytes of the bytestream before the packet.
+      /// Has one more element than there are packets, which holds the total.
+      std::vector<std::vector<uint64_t>> bytestreamOffsets_;
+   };
+
+   /// The PacketIndexes of one E57 file, optionally kept in a sidecar file so the packets are only scanned once.
+   /// The sidecar is tied to the E57 file by its size, modification time & GUID, and is ignored (and replaced) if
+   /// any of them differ or it can't be read. It may be used by readers on different threads.
+   class PacketIndexFile
+   {
+   public:
+      struct Key
+      {
+         uint64_t fileSize = 0;
+         int64_t modificationTime = 0;
+         ustring guid;
+      };
+
+      /// An empty path keeps the indexes in memory only
+      PacketIndexFile( const ustring &path, const Key &key );
+
+      /// Get the index of the section starting at sectionLogicalStart, nullptr if we don't have it
+      const PacketIndex *find( uint64_t sectionLogicalStart ) const;
+
+      /// Take ownership of the index of a section & save the sidecar. If another reader added one for the section
+      /// first, that one is kept & returned instead.
+      const PacketIndex *add( uint64_t sectionLogicalStart, std::unique_ptr<PacketIndex> index );
+
+   private:
+      void load();
+      void save() const;
+
+      ustring path_;
+      Key key_;
+
+      /// Indexes are never removed once added, so they can be used without holding mutex_
+      mutable std::mutex mutex_;
+      std::map<uint64_t, std::unique_ptr<PacketIndex>> indexes_; /// section logical start -> index
+
+      /// Keeps one save() at a time writing the sidecar
+      mutable std::mutex saveMutex_;
+   };
+}
@@ -173,8 +173,24 @@ namespace e57
       }
    }
 
+   //! @brief Converts the Reader options to the options used to open the ImageFile
+   ImageFileOptions _imageFileOptions( const ReaderOptions &options )
+   {
+      ImageFileOptions imageFileOptions;
+
+      imageFileOptions.checksumPolicy = options.checksumPolicy;
+      imageFileOptions.memoryMapped = options.memoryMapped;
+      imageFileOptions.packetCacheSize = options.packetCacheSize;
+      imageFileOptions.readAheadPacketCount = options.readAheadPacketCount;
+      imageFileOptions.packetIndexPath = options.packetIndexPath;
+      imageFileOptions.decodeThreadCount = options.decodeThreadCount;
+      imageFileOptions.decodeExecutor = options.decodeExecutor;
+
+      return imageFileOptions;
+   }
+
    ReaderImpl::ReaderImpl( const ustring &filePath, const ReaderOptions &options ) :
-      imf_( filePath, "r", options.checksumPolicy ), root_( imf_.root() ), data3D_( root_.get( "/data3D" ) ),
+      imf_( filePath, "r", _imageFileOptions( options ) ), root_( imf_.root() ), data3D_( root_.get( "/data3D" ) ),
       images2D_( root_.isDefined( "/images2D" ) ? root_.get( "/images2D" ) : VectorNode( imf_ ) )
    {
    }
@@ -422,3 +422,10 @@ void SourceDestBuffer::dump( int indent, std::ostream &os ) const
 {
 }
 #endif
+
+//! @cond documentNonPublic   The following isn't part of the API, and isn't
+//! documented.
+SourceDestBuffer::SourceDestBuffer( std::shared_ptr<SourceDestBufferImpl> ni ) : impl_( ni )
+{
+}
+//! @endcond
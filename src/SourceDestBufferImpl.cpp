@@ -26,6 +26,8 @@
  */
 
 #include <cmath>
+#include <cstring>
+#include <limits>
 
 #include "ImageFileImpl.h"
 #include "SourceDestBufferImpl.h"
@@ -33,6 +35,39 @@
 
 using namespace e57;
 
+namespace
+{
+   /// Size of an element in the given memory representation, or 0 for ustrings
+   size_t elementSize( MemoryRepresentation representation )
+   {
+      switch ( representation )
+      {
+         case E57_INT8:
+            return sizeof( int8_t );
+         case E57_UINT8:
+            return sizeof( uint8_t );
+         case E57_INT16:
+            return sizeof( int16_t );
+         case E57_UINT16:
+            return sizeof( uint16_t );
+         case E57_INT32:
+            return sizeof( int32_t );
+         case E57_UINT32:
+            return sizeof( uint32_t );
+         case E57_INT64:
+            return sizeof( int64_t );
+         case E57_BOOL:
+            return sizeof( bool );
+         case E57_REAL32:
+            return sizeof( float );
+         case E57_REAL64:
+            return sizeof( double );
+         default:
+            return 0;
+      }
+   }
+}
+
 SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile, const ustring &pathName,
                                             const size_t capacity, bool doConversion, bool doScaling ) :
    destImageFile_( destImageFile ),
@@ -128,152 +163,221 @@ SourceDestBufferImpl::SourceDestBufferImpl( ImageFileImplWeakPtr destImageFile,
    /// stored in it.
 }
 
-template <typename T> void SourceDestBufferImpl::_setNextReal( T inValue )
+std::shared_ptr<SourceDestBufferImpl> SourceDestBufferImpl::slice( size_t first, size_t count ) const
+{
+   if ( ( memoryRepresentation_ == E57_USTRING ) || ( first > capacity_ ) || ( count > capacity_ - first ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ + " first=" + toString( first ) +
+                                                   " count=" + toString( count ) +
+                                                   " capacity=" + toString( capacity_ ) );
+   }
+
+   std::shared_ptr<SourceDestBufferImpl> sliced( new SourceDestBufferImpl( *this ) );
+
+   sliced->base_ = base_ + first * stride_;
+   sliced->capacity_ = count;
+   sliced->nextIndex_ = 0;
+
+   return sliced;
+}
+
+void SourceDestBufferImpl::_checkRoom( size_t count ) const
+{
+   if ( count > capacity_ - nextIndex_ )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ + " nextIndex=" + toString( nextIndex_ ) +
+                                                   " count=" + toString( count ) );
+   }
+}
+
+void SourceDestBufferImpl::_checkConversion() const
+{
+   if ( !doConversion_ )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
+   }
+}
+
+template <typename T, typename ValueT, typename Function>
+void SourceDestBufferImpl::_getNextBlock( ValueT *values, size_t count, Function convert )
+{
+   const char *p = base_ + nextIndex_ * stride_;
+
+   /// Contiguous buffers get a loop the compiler can unroll and vectorize
+   if ( stride_ == sizeof( T ) )
+   {
+      auto in = reinterpret_cast<const T *>( p );
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         values[i] = convert( in[i] );
+      }
+   }
+   else
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         values[i] = convert( *reinterpret_cast<const T *>( p + i * stride_ ) );
+      }
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename T> void SourceDestBufferImpl::_getNextBlock( T *values, size_t count )
+{
+   if ( stride_ == sizeof( T ) )
+   {
+      memcpy( values, base_ + nextIndex_ * stride_, count * sizeof( T ) );
+      nextIndex_ += static_cast<unsigned>( count );
+   }
+   else
+   {
+      _getNextBlock<T>( values, count, []( T value ) { return value; } );
+   }
+}
+
+template <typename T, typename ValueT, typename Function>
+void SourceDestBufferImpl::_setNextBlock( const ValueT *values, size_t count, Function convert )
+{
+   char *p = base_ + nextIndex_ * stride_;
+
+   /// Contiguous buffers get a loop the compiler can unroll and vectorize
+   if ( stride_ == sizeof( T ) )
+   {
+      auto out = reinterpret_cast<T *>( p );
+
+      for ( size_t i = 0; i < count; ++i )
+      {
+         out[i] = convert( values[i] );
+      }
+   }
+   else
+   {
+      for ( size_t i = 0; i < count; ++i )
+      {
+         *reinterpret_cast<T *>( p + i * stride_ ) = convert( values[i] );
+      }
+   }
+
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+template <typename T> void SourceDestBufferImpl::_setNextBlock( const T *values, size_t count )
+{
+   if ( stride_ == sizeof( T ) )
+   {
+      memcpy( base_ + nextIndex_ * stride_, values, count * sizeof( T ) );
+      nextIndex_ += static_cast<unsigned>( count );
+   }
+   else
+   {
+      _setNextBlock<T>( values, count, []( T value ) { return value; } );
+   }
+}
+
+template <typename T, typename ValueT, typename Function>
+void SourceDestBufferImpl::_setNextIntegerBlock( const ValueT *values, size_t count, ErrorCode error,
+                                                 const char *valueName, Function transform )
+{
+   _setNextBlock<T>( values, count, [this, error, valueName, transform]( ValueT value ) {
+      const auto transformed = transform( value );
+
+      if ( transformed < std::numeric_limits<T>::lowest() || std::numeric_limits<T>::max() < transformed )
+      {
+         throw E57_EXCEPTION2( error, "pathName=" + pathName_ + " " + valueName + "=" + toString( transformed ) );
+      }
+
+      return static_cast<T>( transformed );
+   } );
+}
+
+template <typename T> void SourceDestBufferImpl::_setNextRealBlock( const T *values, size_t count )
 {
    static_assert( std::is_same<T, double>::value || std::is_same<T, float>::value,
-                  "_setNextReal() requires float or double type" );
+                  "_setNextRealBlock() requires float or double type" );
 
    /// don't checkImageFileOpen
 
    /// Verify have room
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Calc start of memory location, index into buffer using stride_ (the
-   /// distance between elements).
-   char *p = &base_[nextIndex_ * stride_];
+   const auto same = []( T value ) { return value; };
 
    switch ( memoryRepresentation_ )
    {
+      //??? fault if get special value: NaN, NegInf...  (all ints)
       case E57_INT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         //??? fault if get special value: NaN, NegInf...  (all other ints below
-         // too)
-         if ( inValue < E57_INT8_MIN || E57_INT8_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<int8_t *>( p ) = static_cast<int8_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<int8_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_UINT8_MIN || E57_UINT8_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<uint8_t *>( p ) = static_cast<uint8_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<uint8_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_INT16_MIN || E57_INT16_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<int16_t *>( p ) = static_cast<int16_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<int16_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_UINT16_MIN || E57_UINT16_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<uint16_t *>( p ) = static_cast<uint16_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<uint16_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_INT32_MIN || E57_INT32_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<int32_t *>( p ) = static_cast<int32_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<int32_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_UINT32_MIN || E57_UINT32_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<uint32_t *>( p ) = static_cast<uint32_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<uint32_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         if ( inValue < E57_INT64_MIN || E57_INT64_MAX < inValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( inValue ) );
-         }
-         *reinterpret_cast<int64_t *>( p ) = static_cast<int64_t>( inValue );
+         _checkConversion();
+         _setNextIntegerBlock<int64_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_BOOL:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         *reinterpret_cast<bool *>( p ) = ( inValue ? false : true );
+         _checkConversion();
+         _setNextBlock<bool>( values, count, []( T value ) { return ( value ? false : true ); } );
          break;
       case E57_REAL32:
-         if ( std::is_same<T, double>::value )
+         if ( std::is_same<T, float>::value )
          {
-            /// Does this count as conversion?  It loses information.
-            /// Check for really large exponents that can't fit in a single
-            /// precision
-            if ( inValue < E57_DOUBLE_MIN || E57_DOUBLE_MAX < inValue )
-            {
-               throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                     "pathName=" + pathName_ + " value=" + toString( inValue ) );
-            }
-            *reinterpret_cast<float *>( p ) = static_cast<float>( inValue );
+            /// Only reached when T is float
+            _setNextBlock( reinterpret_cast<const float *>( values ), count );
          }
          else
          {
-#ifdef _MSC_VER
-            // MSVC is not smart enough to realize 'inValue' cannot be a double here, so disable warning
-#pragma warning( disable : 4244 )
-            *reinterpret_cast<float *>( p ) = inValue;
-#pragma warning( default : 4244 )
-#else
-            *reinterpret_cast<float *>( p ) = inValue;
-#endif
+            /// Does this count as conversion?  It loses information.
+            /// Check for really large exponents that can't fit in a single
+            /// precision
+            _setNextBlock<float>( values, count, [this]( T value ) {
+               if ( value < E57_DOUBLE_MIN || E57_DOUBLE_MAX < value )
+               {
+                  throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
+                                        "pathName=" + pathName_ + " value=" + toString( value ) );
+               }
+
+               return static_cast<float>( value );
+            } );
          }
          break;
       case E57_REAL64:
          //??? does this count as a conversion?
-         *reinterpret_cast<double *>( p ) = static_cast<double>( inValue );
+         if ( std::is_same<T, double>::value )
+         {
+            /// Only reached when T is double
+            _setNextBlock( reinterpret_cast<const double *>( values ), count );
+         }
+         else
+         {
+            _setNextBlock<double>( values, count, []( T value ) { return static_cast<double>( value ); } );
+         }
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-
-   nextIndex_++;
 }
 
 void SourceDestBufferImpl::checkState_() const
@@ -313,81 +417,105 @@ void SourceDestBufferImpl::checkState_() const
    }
 }
 
-int64_t SourceDestBufferImpl::getNextInt64()
+bool SourceDestBufferImpl::isContiguous( MemoryRepresentation representation ) const
+{
+   return ( memoryRepresentation_ == representation ) && ( representation != E57_USTRING ) &&
+          ( stride_ == elementSize( representation ) );
+}
+
+void SourceDestBufferImpl::getNextBytes( char *bytes, size_t count )
 {
    /// don't checkImageFileOpen
 
+   if ( !isContiguous( memoryRepresentation_ ) )
+   {
+      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
+   }
+
    /// Verify index is within bounds
-   if ( nextIndex_ >= capacity_ )
+   _checkRoom( count );
+
+   memcpy( bytes, base_ + nextIndex_ * stride_, count * stride_ );
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::setNextBytes( const char *bytes, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   if ( !isContiguous( memoryRepresentation_ ) )
    {
       throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
 
-   /// Fetch value from source buffer.
+   /// Verify have room
+   _checkRoom( count );
+
+   memcpy( base_ + nextIndex_ * stride_, bytes, count * stride_ );
+   nextIndex_ += static_cast<unsigned>( count );
+}
+
+void SourceDestBufferImpl::getNextBlock( int64_t *values, size_t count )
+{
+   /// don't checkImageFileOpen
+
+   /// Verify index is within bounds
+   _checkRoom( count );
+
+   /// Fetch values from source buffer.
    /// Convert from non-integer formats if requested.
-   char *p = &base_[nextIndex_ * stride_];
-   int64_t value;
+   const auto toInt64 = []( auto value ) { return static_cast<int64_t>( value ); };
+
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         value = static_cast<int64_t>( *reinterpret_cast<int8_t *>( p ) );
+         _getNextBlock<int8_t>( values, count, toInt64 );
          break;
       case E57_UINT8:
-         value = static_cast<int64_t>( *reinterpret_cast<uint8_t *>( p ) );
+         _getNextBlock<uint8_t>( values, count, toInt64 );
          break;
       case E57_INT16:
-         value = static_cast<int64_t>( *reinterpret_cast<int16_t *>( p ) );
+         _getNextBlock<int16_t>( values, count, toInt64 );
          break;
       case E57_UINT16:
-         value = static_cast<int64_t>( *reinterpret_cast<uint16_t *>( p ) );
+         _getNextBlock<uint16_t>( values, count, toInt64 );
          break;
       case E57_INT32:
-         value = static_cast<int64_t>( *reinterpret_cast<int32_t *>( p ) );
+         _getNextBlock<int32_t>( values, count, toInt64 );
          break;
       case E57_UINT32:
-         value = static_cast<int64_t>( *reinterpret_cast<uint32_t *>( p ) );
+         _getNextBlock<uint32_t>( values, count, toInt64 );
          break;
       case E57_INT64:
-         value = *reinterpret_cast<int64_t *>( p );
+         _getNextBlock( values, count );
          break;
       case E57_BOOL:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         /// Convert bool to 0/1, all non-zero values map to 1.0
-         value = ( *reinterpret_cast<bool *>( p ) ) ? 1 : 0;
+         _checkConversion();
+         /// Convert bool to 0/1, all non-zero values map to 1
+         _getNextBlock<bool>( values, count, toInt64 );
          break;
       case E57_REAL32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          //??? fault if get special value: NaN, NegInf...
-         value = static_cast<int64_t>( *reinterpret_cast<float *>( p ) );
+         _getNextBlock<float>( values, count, toInt64 );
          break;
       case E57_REAL64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          //??? fault if get special value: NaN, NegInf...
-         value = static_cast<int64_t>( *reinterpret_cast<double *>( p ) );
+         _getNextBlock<double>( values, count, toInt64 );
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
       default:
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-   nextIndex_++;
-   return ( value );
 }
 
-int64_t SourceDestBufferImpl::getNextInt64( double scale, double offset )
+void SourceDestBufferImpl::getNextBlock( int64_t *values, size_t count, double scale, double offset )
 {
    /// don't checkImageFileOpen
 
-   /// Reverse scale (undo scaling) of a user's number to get raw value to put
+   /// Reverse scale (undo scaling) of a user's numbers to get raw values to put
    /// in file.
 
    /// Incorporating the scale is optional (requested by user when constructing
@@ -395,8 +523,9 @@ int64_t SourceDestBufferImpl::getNextInt64( double scale, double offset )
    /// from user's buffer.
    if ( !doScaling_ )
    {
-      /// Just return raw value.
-      return ( getNextInt64() );
+      /// Just return raw values.
+      getNextBlock( values, count );
+      return;
    }
 
    /// Double check non-zero scale.  Going to divide by it below.
@@ -406,288 +535,196 @@ int64_t SourceDestBufferImpl::getNextInt64( double scale, double offset )
    }
 
    /// Verify index is within bounds
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Fetch value from source buffer.
+   /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating
+   /// point until sure is in bounds
+   const auto toRaw = [this, scale, offset]( double value ) {
+      const double doubleRawValue = floor( ( value - offset ) / scale + 0.5 );
+
+      /// Make sure that value is representable in an int64_t
+      if ( doubleRawValue < E57_INT64_MIN || E57_INT64_MAX < doubleRawValue )
+      {
+         throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
+                               "pathName=" + pathName_ + " value=" + toString( doubleRawValue ) );
+      }
+
+      return static_cast<int64_t>( doubleRawValue );
+   };
+
+   /// Fetch values from source buffer.
    /// Convert from non-integer formats if requested
-   char *p = &base_[nextIndex_ * stride_];
-   double doubleRawValue;
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<int8_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<int8_t>( values, count, toRaw );
          break;
       case E57_UINT8:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<uint8_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<uint8_t>( values, count, toRaw );
          break;
       case E57_INT16:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<int16_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<int16_t>( values, count, toRaw );
          break;
       case E57_UINT16:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<uint16_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<uint16_t>( values, count, toRaw );
          break;
       case E57_INT32:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<int32_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<int32_t>( values, count, toRaw );
          break;
       case E57_UINT32:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<uint32_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<uint32_t>( values, count, toRaw );
          break;
       case E57_INT64:
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<int64_t *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<int64_t>( values, count, toRaw );
          break;
       case E57_BOOL:
-         if ( *reinterpret_cast<bool *>( p ) )
-         {
-            doubleRawValue = floor( ( 1 - offset ) / scale + 0.5 );
-         }
-         else
-         {
-            doubleRawValue = floor( ( 0 - offset ) / scale + 0.5 );
-         }
+         /// true and false scale as 1 and 0
+         _getNextBlock<bool>( values, count, toRaw );
          break;
       case E57_REAL32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          //??? fault if get special value: NaN, NegInf...
-
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<float *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<float>( values, count, toRaw );
          break;
       case E57_REAL64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          //??? fault if get special value: NaN, NegInf...
-
-         /// Calc (x-offset)/scale rounded to nearest integer, but keep in
-         /// floating point until sure is in bounds
-         doubleRawValue = floor( ( *reinterpret_cast<double *>( p ) - offset ) / scale + 0.5 );
+         _getNextBlock<double>( values, count, toRaw );
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
       default:
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-   /// Make sure that value is representable in an int64_t
-   if ( doubleRawValue < E57_INT64_MIN || E57_INT64_MAX < doubleRawValue )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                            "pathName=" + pathName_ + " value=" + toString( doubleRawValue ) );
-   }
-
-   auto rawValue = static_cast<int64_t>( doubleRawValue );
-
-   nextIndex_++;
-   return ( rawValue );
 }
 
-float SourceDestBufferImpl::getNextFloat()
+void SourceDestBufferImpl::getNextBlock( float *values, size_t count )
 {
    /// don't checkImageFileOpen
 
    /// Verify index is within bounds
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Fetch value from source buffer.
+   /// Fetch values from source buffer.
    /// Convert from other formats to floating point if requested
-   char *p = &base_[nextIndex_ * stride_];
-   float value;
+   const auto toFloat = []( auto value ) { return static_cast<float>( value ); };
+
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<int8_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int8_t>( values, count, toFloat );
          break;
       case E57_UINT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<uint8_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint8_t>( values, count, toFloat );
          break;
       case E57_INT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<int16_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int16_t>( values, count, toFloat );
          break;
       case E57_UINT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<uint16_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint16_t>( values, count, toFloat );
          break;
       case E57_INT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<int32_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int32_t>( values, count, toFloat );
          break;
       case E57_UINT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<uint32_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint32_t>( values, count, toFloat );
          break;
       case E57_INT64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<float>( *reinterpret_cast<int64_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int64_t>( values, count, toFloat );
          break;
       case E57_BOOL:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-
+         _checkConversion();
          /// Convert bool to 0/1, all non-zero values map to 1.0
-         value = ( *reinterpret_cast<bool *>( p ) ) ? 1.0F : 0.0F;
+         _getNextBlock<bool>( values, count, toFloat );
          break;
       case E57_REAL32:
-         value = *reinterpret_cast<float *>( p );
+         _getNextBlock( values, count );
          break;
       case E57_REAL64:
-      {
          /// Check that exponent of user's value is not too large for single
          /// precision number in file.
-         double d = *reinterpret_cast<double *>( p );
+         _getNextBlock<double>( values, count, [this]( double value ) {
+            ///??? silently limit here?
+            if ( value < E57_DOUBLE_MIN || E57_DOUBLE_MAX < value )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_REAL64_TOO_LARGE,
+                                     "pathName=" + pathName_ + " value=" + toString( value ) );
+            }
 
-         ///??? silently limit here?
-         if ( d < E57_DOUBLE_MIN || E57_DOUBLE_MAX < d )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_REAL64_TOO_LARGE, "pathName=" + pathName_ + " value=" + toString( d ) );
-         }
-         value = static_cast<float>( d );
+            return static_cast<float>( value );
+         } );
          break;
-      }
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
       default:
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-   nextIndex_++;
-   return ( value );
 }
 
-double SourceDestBufferImpl::getNextDouble()
+void SourceDestBufferImpl::getNextBlock( double *values, size_t count )
 {
    /// don't checkImageFileOpen
 
    /// Verify index is within bounds
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Fetch value from source buffer.
+   /// Fetch values from source buffer.
    /// Convert from other formats to floating point if requested
-   char *p = &base_[nextIndex_ * stride_];
-   double value;
+   const auto toDouble = []( auto value ) { return static_cast<double>( value ); };
+
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<int8_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int8_t>( values, count, toDouble );
          break;
       case E57_UINT8:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<uint8_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint8_t>( values, count, toDouble );
          break;
       case E57_INT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<int16_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int16_t>( values, count, toDouble );
          break;
       case E57_UINT16:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<uint16_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint16_t>( values, count, toDouble );
          break;
       case E57_INT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<int32_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int32_t>( values, count, toDouble );
          break;
       case E57_UINT32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<uint32_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<uint32_t>( values, count, toDouble );
          break;
       case E57_INT64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         value = static_cast<double>( *reinterpret_cast<int64_t *>( p ) );
+         _checkConversion();
+         _getNextBlock<int64_t>( values, count, toDouble );
          break;
       case E57_BOOL:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          /// Convert bool to 0/1, all non-zero values map to 1.0
-         value = ( *reinterpret_cast<bool *>( p ) ) ? 1.0 : 0.0;
+         _getNextBlock<bool>( values, count, toDouble );
          break;
       case E57_REAL32:
-         value = static_cast<double>( *reinterpret_cast<float *>( p ) );
+         _getNextBlock<float>( values, count, toDouble );
          break;
       case E57_REAL64:
-         value = *reinterpret_cast<double *>( p );
+         _getNextBlock( values, count );
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
       default:
          throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-   nextIndex_++;
-   return ( value );
 }
 
 ustring SourceDestBufferImpl::getNextString()
@@ -710,99 +747,58 @@ ustring SourceDestBufferImpl::getNextString()
    return ( ( *ustrings_ )[nextIndex_++] );
 }
 
-void SourceDestBufferImpl::setNextInt64( int64_t value )
+void SourceDestBufferImpl::setNextBlock( const int64_t *values, size_t count )
 {
    /// don't checkImageFileOpen
 
    /// Verify have room
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Calc start of memory location, index into buffer using stride_ (the
-   /// distance between elements).
-   char *p = &base_[nextIndex_ * stride_];
+   const auto same = []( int64_t value ) { return value; };
 
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         if ( value < E57_INT8_MIN || E57_INT8_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<int8_t *>( p ) = static_cast<int8_t>( value );
+         _setNextIntegerBlock<int8_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT8:
-         if ( value < E57_UINT8_MIN || E57_UINT8_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<uint8_t *>( p ) = static_cast<uint8_t>( value );
+         _setNextIntegerBlock<uint8_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT16:
-         if ( value < E57_INT16_MIN || E57_INT16_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<int16_t *>( p ) = static_cast<int16_t>( value );
+         _setNextIntegerBlock<int16_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT16:
-         if ( value < E57_UINT16_MIN || E57_UINT16_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<uint16_t *>( p ) = static_cast<uint16_t>( value );
+         _setNextIntegerBlock<uint16_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT32:
-         if ( value < E57_INT32_MIN || E57_INT32_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<int32_t *>( p ) = static_cast<int32_t>( value );
+         _setNextIntegerBlock<int32_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_UINT32:
-         if ( value < E57_UINT32_MIN || E57_UINT32_MAX < value )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " value=" + toString( value ) );
-         }
-         *reinterpret_cast<uint32_t *>( p ) = static_cast<uint32_t>( value );
+         _setNextIntegerBlock<uint32_t>( values, count, E57_ERROR_VALUE_NOT_REPRESENTABLE, "value", same );
          break;
       case E57_INT64:
-         *reinterpret_cast<int64_t *>( p ) = static_cast<int64_t>( value );
+         _setNextBlock( values, count );
          break;
       case E57_BOOL:
-         *reinterpret_cast<bool *>( p ) = ( value ? false : true );
+         _setNextBlock<bool>( values, count, []( int64_t value ) { return ( value ? false : true ); } );
          break;
       case E57_REAL32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          //??? very large integers may lose some lowest bits here. error?
-         *reinterpret_cast<float *>( p ) = static_cast<float>( value );
+         _setNextBlock<float>( values, count, []( int64_t value ) { return static_cast<float>( value ); } );
          break;
       case E57_REAL64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         *reinterpret_cast<double *>( p ) = static_cast<double>( value );
+         _checkConversion();
+         _setNextBlock<double>( values, count, []( int64_t value ) { return static_cast<double>( value ); } );
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-
-   nextIndex_++;
 }
 
-void SourceDestBufferImpl::setNextInt64( int64_t value, double scale, double offset )
+void SourceDestBufferImpl::setNextBlock( const int64_t *values, size_t count, double scale, double offset )
 {
    /// don't checkImageFileOpen
 
@@ -815,128 +811,91 @@ void SourceDestBufferImpl::setNextInt64( int64_t value, double scale, double off
    if ( !doScaling_ )
    {
       /// Use raw value routine, then bail out.
-      setNextInt64( value );
+      setNextBlock( values, count );
       return;
    }
 
    /// Verify have room
-   if ( nextIndex_ >= capacity_ )
-   {
-      throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
-   }
+   _checkRoom( count );
 
-   /// Calc start of memory location, index into buffer using stride_ (the
-   /// distance between elements).
-   char *p = &base_[nextIndex_ * stride_];
+   /// Calc x*scale+offset. Values stored in some floating point rep in user's
+   /// buffer keep full resolution.
+   const auto scaled = [scale, offset]( int64_t value ) { return value * scale + offset; };
 
-   /// Calc x*scale+offset
-   double scaledValue;
-   if ( memoryRepresentation_ == E57_REAL32 || memoryRepresentation_ == E57_REAL64 )
-   {
-      /// Value will be stored in some floating point rep in user's buffer, so
-      /// keep full resolution here.
-      scaledValue = value * scale + offset;
-   }
-   else
-   {
-      /// Value will represented as some integer in user's buffer, so round to
-      /// nearest integer here. But keep in floating point rep until we know
-      /// that the value is representable in the user's buffer.
-      scaledValue = floor( value * scale + offset + 0.5 );
-   }
+   /// Values represented as some integer in user's buffer are rounded to the
+   /// nearest integer. But keep in floating point rep until we know that the
+   /// value is representable in the user's buffer.
+   const auto rounded = [scale, offset]( int64_t value ) { return floor( value * scale + offset + 0.5 ); };
 
    switch ( memoryRepresentation_ )
    {
       case E57_INT8:
-         if ( scaledValue < E57_INT8_MIN || E57_INT8_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<int8_t *>( p ) = static_cast<int8_t>( scaledValue );
+         _setNextIntegerBlock<int8_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                       rounded );
          break;
       case E57_UINT8:
-         if ( scaledValue < E57_UINT8_MIN || E57_UINT8_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<uint8_t *>( p ) = static_cast<uint8_t>( scaledValue );
+         _setNextIntegerBlock<uint8_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                        rounded );
          break;
       case E57_INT16:
-         if ( scaledValue < E57_INT16_MIN || E57_INT16_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<int16_t *>( p ) = static_cast<int16_t>( scaledValue );
+         _setNextIntegerBlock<int16_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                        rounded );
          break;
       case E57_UINT16:
-         if ( scaledValue < E57_UINT16_MIN || E57_UINT16_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<uint16_t *>( p ) = static_cast<uint16_t>( scaledValue );
+         _setNextIntegerBlock<uint16_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                         rounded );
          break;
       case E57_INT32:
-         if ( scaledValue < E57_INT32_MIN || E57_INT32_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<int32_t *>( p ) = static_cast<int32_t>( scaledValue );
+         _setNextIntegerBlock<int32_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                        rounded );
          break;
       case E57_UINT32:
-         if ( scaledValue < E57_UINT32_MIN || E57_UINT32_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<uint32_t *>( p ) = static_cast<uint32_t>( scaledValue );
+         _setNextIntegerBlock<uint32_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                         rounded );
          break;
       case E57_INT64:
-         *reinterpret_cast<int64_t *>( p ) = static_cast<int64_t>( scaledValue );
+         _setNextIntegerBlock<int64_t>( values, count, E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "scaledValue",
+                                        rounded );
          break;
       case E57_BOOL:
-         *reinterpret_cast<bool *>( p ) = ( scaledValue ? false : true );
+         _setNextBlock<bool>( values, count,
+                              [rounded]( int64_t value ) { return ( rounded( value ) ? false : true ); } );
          break;
       case E57_REAL32:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
+         _checkConversion();
          /// Check that exponent of result is not too big for single precision
          /// float
-         if ( scaledValue < E57_DOUBLE_MIN || E57_DOUBLE_MAX < scaledValue )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
-                                  "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
-         }
-         *reinterpret_cast<float *>( p ) = static_cast<float>( scaledValue );
+         _setNextBlock<float>( values, count, [this, scaled]( int64_t value ) {
+            const double scaledValue = scaled( value );
+
+            if ( scaledValue < E57_DOUBLE_MIN || E57_DOUBLE_MAX < scaledValue )
+            {
+               throw E57_EXCEPTION2( E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
+                                     "pathName=" + pathName_ + " scaledValue=" + toString( scaledValue ) );
+            }
+
+            return static_cast<float>( scaledValue );
+         } );
          break;
       case E57_REAL64:
-         if ( !doConversion_ )
-         {
-            throw E57_EXCEPTION2( E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_ );
-         }
-         *reinterpret_cast<double *>( p ) = scaledValue;
+         _checkConversion();
+         _setNextBlock<double>( values, count, scaled );
          break;
       case E57_USTRING:
          throw E57_EXCEPTION2( E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_ );
+      default:
+         throw E57_EXCEPTION2( E57_ERROR_INTERNAL, "pathName=" + pathName_ );
    }
-
-   nextIndex_++;
 }
 
-void SourceDestBufferImpl::setNextFloat( float value )
+void SourceDestBufferImpl::setNextBlock( const float *values, size_t count )
 {
-   _setNextReal( value );
+   _setNextRealBlock( values, count );
 }
 
-void SourceDestBufferImpl::setNextDouble( double value )
+void SourceDestBufferImpl::setNextBlock( const double *values, size_t count )
 {
-   _setNextReal( value );
+   _setNextRealBlock( values, count );
 }
 
 void SourceDestBufferImpl::setNextString( const ustring &value )
@@ -98,15 +98,40 @@ namespace e57
          nextIndex_ = 0;
       }
 
-      int64_t getNextInt64();
-      int64_t getNextInt64( double scale, double offset );
-      float getNextFloat();
-      double getNextDouble();
+      /// Mark the first count elements as set, when they were filled in through slices
+      void setNextIndex( unsigned count )
+      {
+         nextIndex_ = count;
+      }
+
+      /// A buffer for the count elements of this one starting at first, so parts of it can be filled in on
+      /// different threads. Can't be used with ustring buffers.
+      std::shared_ptr<SourceDestBufferImpl> slice( size_t first, size_t count ) const;
+
+      /// Whether the elements are stored one after another in the given representation, so can be copied as bytes
+      bool isContiguous( MemoryRepresentation representation ) const;
+
+      /// Copy the bytes of the next count elements, which must be contiguous (see isContiguous()). The bytes needn't
+      /// be aligned.
+      void getNextBytes( char *bytes, size_t count );
+      void setNextBytes( const char *bytes, size_t count );
+
+      /// Fetch the next count values, converting them from the buffer's memory representation as required. The
+      /// representation is switched on once per block rather than once per value, and contiguous buffers of the
+      /// same type are copied with memcpy.
+      void getNextBlock( int64_t *values, size_t count );
+      /// As above, and if doScaling() undo scale and offset, rounding to the nearest integer
+      void getNextBlock( int64_t *values, size_t count, double scale, double offset );
+      void getNextBlock( float *values, size_t count );
+      void getNextBlock( double *values, size_t count );
       ustring getNextString();
-      void setNextInt64( int64_t value );
-      void setNextInt64( int64_t value, double scale, double offset );
-      void setNextFloat( float value );
-      void setNextDouble( double value );
+
+      /// Store the next count values, converting them to the buffer's memory representation as required
+      void setNextBlock( const int64_t *values, size_t count );
+      /// As above, and if doScaling() apply scale and offset
+      void setNextBlock( const int64_t *values, size_t count, double scale, double offset );
+      void setNextBlock( const float *values, size_t count );
+      void setNextBlock( const double *values, size_t count );
       void setNextString( const ustring &value );
 
       void checkCompatible( const std::shared_ptr<SourceDestBufferImpl> &newBuf ) const;
@@ -116,7 +141,25 @@ namespace e57
 #endif
 
    private:
-      template <typename T> void _setNextReal( T inValue );
+      void _checkRoom( size_t count ) const;
+      void _checkConversion() const;
+
+      /// Read count elements of type T, passing each through convert
+      template <typename T, typename ValueT, typename Function>
+      void _getNextBlock( ValueT *values, size_t count, Function convert );
+      template <typename T> void _getNextBlock( T *values, size_t count );
+
+      /// Write count elements of type T, each the result of passing a value through convert
+      template <typename T, typename ValueT, typename Function>
+      void _setNextBlock( const ValueT *values, size_t count, Function convert );
+      template <typename T> void _setNextBlock( const T *values, size_t count );
+
+      /// Write count elements of integer type T, throwing error if transform of a value doesn't fit in T
+      template <typename T, typename ValueT, typename Function>
+      void _setNextIntegerBlock( const ValueT *values, size_t count, ErrorCode error, const char *valueName,
+                                 Function transform );
+
+      template <typename T> void _setNextRealBlock( const T *values, size_t count );
 
       void checkState_() const; /// Common routine to check that constructor
                                 /// arguments were ok, throws if not
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <atomic>
+#include <memory>
+
+#include "ThreadPool.h"
+
+namespace e57
+{
+   ThreadPool::ThreadPool( unsigned threadCount )
+   {
+      threads_.reserve( threadCount );
+
+      for ( unsigned i = 0; i < threadCount; ++i )
+      {
+         threads_.emplace_back( &ThreadPool::run, this );
+      }
+   }
+
+   ThreadPool::~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         stopping_ = true;
+      }
+
+      workAvailable_.notify_all();
+
+      for ( auto &thread : threads_ )
+      {
+         thread.join();
+      }
+   }
+
+   void ThreadPool::submit( std::function<void()> task )
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         tasks_.push_back( std::move( task ) );
+      }
+
+      workAvailable_.notify_one();
+   }
+
+   void ThreadPool::run()
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      while ( true )
+      {
+         workAvailable_.wait( lock, [this] { return stopping_ || !tasks_.empty(); } );
+
+         /// Finish everything queued before stopping, someone may be waiting for it
+         if ( tasks_.empty() )
+         {
+            return;
+         }
+
+         std::function<void()> task( std::move( tasks_.front() ) );
+         tasks_.pop_front();
+
+         lock.unlock();
+
+         task();
+
+         lock.lock();
+      }
+   }
+
+   TaskGroup::TaskGroup( const TaskExecutor &executor ) : executor_( executor )
+   {
+   }
+
+   TaskGroup::~TaskGroup()
+   {
+      /// The tasks may refer to things which are about to be destroyed
+      waitForTasks();
+   }
+
+   void TaskGroup::run( std::function<void()> task )
+   {
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         ++runningCount_;
+      }
+
+      /// Whether the task has started, or been given up on because the executor threw before running it. Only one
+      /// of the task & the error handling below may count it as finished. A task given up on doesn't touch us, since
+      /// we may be gone by the time it runs.
+      enum State
+      {
+         Pending,
+         Started,
+         Abandoned
+      };
+
+      auto state = std::make_shared<std::atomic<int>>( Pending );
+
+      auto wrapped = [this, task, state]() {
+         int expected = Pending;
+
+         if ( !state->compare_exchange_strong( expected, Started ) )
+         {
+            return;
+         }
+
+         std::exception_ptr error;
+
+         try
+         {
+            task();
+         }
+         catch ( ... )
+         {
+            error = std::current_exception();
+         }
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( error && !error_ )
+         {
+            error_ = error;
+         }
+
+         --runningCount_;
+
+         taskDone_.notify_all();
+      };
+
+      try
+      {
+         executor_( wrapped );
+      }
+      catch ( ... )
+      {
+         int expected = Pending;
+         const bool abandoned = state->compare_exchange_strong( expected, Abandoned );
+
+         std::lock_guard<std::mutex> lock( mutex_ );
+
+         if ( !error_ )
+         {
+            error_ = std::current_exception();
+         }
+
+         /// If the executor ran the task (or started it elsewhere) before throwing, the task counts itself
+         if ( abandoned )
+         {
+            --runningCount_;
+
+            taskDone_.notify_all();
+         }
+      }
+   }
+
+   void TaskGroup::wait()
+   {
+      waitForTasks();
+
+      std::exception_ptr error;
+
+      {
+         std::lock_guard<std::mutex> lock( mutex_ );
+         std::swap( error, error_ );
+      }
+
+      if ( error )
+      {
+         std::rethrow_exception( error );
+      }
+   }
+
+   void TaskGroup::waitForTasks()
+   {
+      std::unique_lock<std::mutex> lock( mutex_ );
+
+      taskDone_.wait( lock, [this] { return runningCount_ == 0; } );
+   }
+}
@@ -0,0 +1,102 @@
+#pragma once
+// SPDX-License-Identifier: MIT
+// Copyright 2022 Andy Maloney <asmaloney@gmail.com>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace e57
+{
+   /// Something which runs tasks, possibly on other threads. Each task must be run exactly once.
+   using TaskExecutor = std::function<void( std::function<void()> task )>;
+
+   /// A fixed number of threads which run tasks in the order they are submitted.
+   class ThreadPool
+   {
+   public:
+      explicit ThreadPool( unsigned threadCount );
+      ~ThreadPool();
+
+      ThreadPool( const ThreadPool & ) = delete;
+      ThreadPool &operator=( const ThreadPool & ) = delete;
+
+      /// Queue a task to be run by the next free thread
+      void submit( std::function<void()> task );
+
+   private:
+      void run();
+
+      std::mutex mutex_;
+      std::condition_variable workAvailable_;
+
+      std::deque<std::function<void()>> tasks_;
+      bool stopping_ = false;
+
+      std::vector<std::thread> threads_;
+   };
+
+   /// Runs a set of tasks using an executor & waits for all of them to finish.
+   /// The first exception thrown by a task (or by the executor) is rethrown by wait().
+   class TaskGroup
+   {
+   public:
+      explicit TaskGroup( const TaskExecutor &executor );
+      ~TaskGroup();
+
+      TaskGroup( const TaskGroup & ) = delete;
+      TaskGroup &operator=( const TaskGroup & ) = delete;
+
+      void run( std::function<void()> task );
+
+      /// Wait for all the tasks to finish & rethrow the first exception
+      void wait();
+
+   private:
+      void waitForTasks();
+
+      const TaskExecutor &executor_;
+
+      std::mutex mutex_;
+      std::condition_variable taskDone_;
+
+      size_t runningCount_ = 0;
+      std::exception_ptr error_;
+   };
+
+   /// Share items out between at most taskCount tasks so each has about the same amount of work to do, where
+   /// lengths[i] is the work for items[i]. The largest items go first, each to the task with the least so far.
+   template <class T>
+   std::vector<std::vector<T>> shareOutWork( const std::vector<T> &items, const std::vector<size_t> &lengths,
+                                             size_t taskCount )
+   {
+      std::vector<size_t> order( items.size() );
+      std::iota( order.begin(), order.end(), size_t( 0 ) );
+
+      std::stable_sort( order.begin(), order.end(),
+                        [&lengths]( size_t lhs, size_t rhs ) { return lengths[lhs] > lengths[rhs]; } );
+
+      taskCount = std::min( taskCount, items.size() );
+
+      std::vector<std::vector<T>> taskItems( taskCount );
+      std::vector<size_t> taskLengths( taskCount, 0 );
+
+      for ( const size_t i : order )
+      {
+         const auto leastLength = std::min_element( taskLengths.begin(), taskLengths.end() );
+         const auto task = static_cast<size_t>( std::distance( taskLengths.begin(), leastLength ) );
+
+         taskItems[task].push_back( items[i] );
+         taskLengths[task] += lengths[i];
+      }
+
+      return taskItems;
+   }
+}
@@ -80,8 +80,22 @@ namespace e57
       return transferred;
    }
 
+   //! @brief Converts the Writer options to the options used to open the ImageFile
+   ImageFileOptions _imageFileOptions( const WriterOptions &options )
+   {
+      ImageFileOptions imageFileOptions;
+
+      imageFileOptions.backgroundWrite = options.backgroundWrite;
+      imageFileOptions.chunkRecordCount = options.chunkRecordCount;
+      imageFileOptions.encodeThreadCount = options.encodeThreadCount;
+      imageFileOptions.encodeExecutor = options.encodeExecutor;
+
+      return imageFileOptions;
+   }
+
    WriterImpl::WriterImpl( const ustring &filePath, const WriterOptions &options ) :
-      imf_( filePath, "w" ), root_( imf_.root() ), data3D_( imf_, true ), images2D_( imf_, true )
+      imf_( filePath, "w", _imageFileOptions( options ) ), root_( imf_.root() ), data3D_( imf_, true ),
+      images2D_( imf_, true )
    {
       // We are using the E57 v1.0 data format standard fieldnames.
       // The standard fieldnames are used without an extension prefix (in the default namespace).
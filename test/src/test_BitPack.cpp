@@ -0,0 +1,258 @@
+// libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitPack.h"
+
+namespace
+{
+   // Straightforward bit-at-a-time unpacking to check against
+   uint64_t referenceUnpack( const std::vector<char> &buf, size_t firstBit, unsigned bitCount )
+   {
+      uint64_t value = 0;
+
+      for ( unsigned k = 0; k < bitCount; ++k )
+      {
+         const size_t bit = firstBit + k;
+         const auto byte = static_cast<unsigned char>( buf[bit / 8] );
+
+         value |= static_cast<uint64_t>( ( byte >> ( bit % 8 ) ) & 1 ) << k;
+      }
+
+      return value;
+   }
+
+   std::vector<char> randomBytes( size_t size )
+   {
+      std::vector<char> data( size );
+
+      uint32_t seed = 12345;
+      for ( auto &c : data )
+      {
+         seed = seed * 1103515245 + 12345;
+         c = static_cast<char>( seed >> 16 );
+      }
+
+      return data;
+   }
+}
+
+// Cover all the widths & paths through the implementations: every starting bit in a word, values near the end of
+// the buffer (which can't be read with a whole 64-bit load), and values spread over 9 bytes.
+TEST( BitPack, UnpackMatchesReference )
+{
+   constexpr int64_t cMinimum = -1000;
+
+   for ( unsigned bitCount = 1; bitCount <= 64; ++bitCount )
+   {
+      for ( size_t firstBit : { 0, 1, 7, 8, 13, 63 } )
+      {
+         for ( size_t count : { 0, 1, 3, 4, 9, 64, 100 } )
+         {
+            // Exactly the bytes holding the values, so reading past them would be caught by sanitizers
+            const std::vector<char> data = randomBytes( ( firstBit + count * bitCount + 7 ) / 8 );
+
+            std::vector<int64_t> values( count + 1, 0x5555 );
+
+            e57::unpackBits( data.data(), data.size(), firstBit, bitCount, count, cMinimum, values.data() );
+
+            for ( size_t i = 0; i < count; ++i )
+            {
+               const auto expected = static_cast<int64_t>( static_cast<uint64_t>( cMinimum ) +
+                                                           referenceUnpack( data, firstBit + i * bitCount, bitCount ) );
+
+               ASSERT_EQ( values[i], expected )
+                  << "bitCount: " << bitCount << " firstBit: " << firstBit << " count: " << count << " i: " << i;
+            }
+
+            // Nothing written past the values
+            ASSERT_EQ( values[count], 0x5555 );
+         }
+      }
+   }
+}
+
+// Pack starting from every sort of partly-filled pending word, and check the bytes against setting one bit at a time.
+TEST( BitPack, PackMatchesReference )
+{
+   constexpr int64_t cMinimum = -1000;
+
+   for ( unsigned bitCount = 1; bitCount <= 64; ++bitCount )
+   {
+      for ( unsigned firstBit : { 0, 1, 7, 8, 13, 63 } )
+      {
+         for ( size_t count : { 0, 1, 3, 4, 9, 32, 64, 100 } )
+         {
+            const std::vector<char> random = randomBytes( 8 * ( count + 1 ) );
+
+            // The part of the random word before firstBit is what's pending
+            uint64_t pending;
+            memcpy( &pending, random.data(), sizeof( pending ) );
+            pending &= ( firstBit == 0 ) ? 0 : ~uint64_t{ 0 } >> ( 64 - firstBit );
+
+            std::vector<int64_t> values( count );
+
+            for ( size_t i = 0; i < count; ++i )
+            {
+               uint64_t bits;
+               memcpy( &bits, random.data() + 8 * ( i + 1 ), sizeof( bits ) );
+
+               if ( bitCount < 64 )
+               {
+                  bits &= ( uint64_t{ 1 } << bitCount ) - 1;
+               }
+
+               values[i] = static_cast<int64_t>( static_cast<uint64_t>( cMinimum ) + bits );
+            }
+
+            // Expected bytes: the whole words written, then what's left pending
+            const size_t totalBits = firstBit + count * bitCount;
+            std::vector<char> expected( ( totalBits / 64 + 1 ) * 8, 0 );
+
+            memcpy( expected.data(), &pending, sizeof( pending ) );
+
+            for ( size_t i = 0; i < count; ++i )
+            {
+               const auto bits = static_cast<uint64_t>( values[i] ) - static_cast<uint64_t>( cMinimum );
+
+               for ( unsigned k = 0; k < bitCount; ++k )
+               {
+                  const size_t bit = firstBit + i * bitCount + k;
+
+                  expected[bit / 8] |= static_cast<char>( ( ( bits >> k ) & 1 ) << ( bit % 8 ) );
+               }
+            }
+
+            std::vector<char> packed( expected.size(), 0x55 );
+            unsigned pendingBitCount = firstBit;
+
+            const size_t written =
+               e57::packBits( values.data(), count, bitCount, cMinimum, pending, pendingBitCount, packed.data() );
+
+            ASSERT_EQ( written, totalBits / 64 * 8 ) << "bitCount: " << bitCount << " firstBit: " << firstBit;
+            ASSERT_EQ( pendingBitCount, totalBits % 64 );
+
+            // Nothing written past the whole words
+            ASSERT_EQ( packed[written], 0x55 );
+
+            memcpy( packed.data() + written, &pending, sizeof( pending ) );
+
+            ASSERT_EQ( packed, expected ) << "bitCount: " << bitCount << " firstBit: " << firstBit
+                                          << " count: " << count;
+
+            // And back again
+            std::vector<int64_t> unpacked( count );
+
+            e57::unpackBits( packed.data(), packed.size(), firstBit, bitCount, count, cMinimum, unpacked.data() );
+
+            ASSERT_EQ( unpacked, values );
+         }
+      }
+   }
+}
+
+TEST( BitPack, FindOutOfBounds )
+{
+   std::vector<int64_t> values( 37 );
+
+   for ( size_t i = 0; i < values.size(); ++i )
+   {
+      values[i] = static_cast<int64_t>( i ) - 10;
+   }
+
+   EXPECT_EQ( e57::findOutOfBounds( values.data(), values.size(), -10, 26 ), values.size() );
+   EXPECT_EQ( e57::findOutOfBounds( values.data(), 0, 0, 0 ), 0 );
+
+   for ( size_t bad = 0; bad < values.size(); ++bad )
+   {
+      const int64_t saved = values[bad];
+
+      values[bad] = 27;
+      EXPECT_EQ( e57::findOutOfBounds( values.data(), values.size(), -10, 26 ), bad );
+
+      values[bad] = -11;
+      EXPECT_EQ( e57::findOutOfBounds( values.data(), values.size(), -10, 26 ), bad );
+
+      values[bad] = saved;
+   }
+
+   // Only the first is reported
+   values[5] = INT64_MAX;
+   values[30] = INT64_MIN;
+   EXPECT_EQ( e57::findOutOfBounds( values.data(), values.size(), -10, 26 ), 5 );
+}
+
+// Both the minimums which allow the fast conversion to double and ones which don't.
+TEST( BitPack, UnpackScaledMatchesReference )
+{
+   constexpr double cScale = 0.001;
+   constexpr double cOffset = -12.5;
+
+   for ( unsigned bitCount = 1; bitCount <= 64; ++bitCount )
+   {
+      for ( int64_t minimum : { int64_t{ -1000 }, int64_t{ -( int64_t{ 1 } << 51 ) }, INT64_MIN } )
+      {
+         for ( size_t count : { 0, 1, 5, 64, 130 } )
+         {
+            const size_t firstBit = 3;
+            const std::vector<char> data = randomBytes( ( firstBit + count * bitCount + 7 ) / 8 );
+
+            std::vector<int64_t> unpacked( count );
+            std::vector<double> values( count + 1, 1.5 );
+
+            e57::unpackBits( data.data(), data.size(), firstBit, bitCount, count, minimum, unpacked.data() );
+            e57::unpackScaledBits( data.data(), data.size(), firstBit, bitCount, count, minimum, cScale, cOffset,
+                                   values.data() );
+
+            for ( size_t i = 0; i < count; ++i )
+            {
+               ASSERT_EQ( values[i], unpacked[i] * cScale + cOffset )
+                  << "bitCount: " << bitCount << " minimum: " << minimum << " i: " << i;
+            }
+
+            ASSERT_EQ( values[count], 1.5 );
+         }
+      }
+   }
+}
+
+TEST( BitPack, UnscaleMatchesReference )
+{
+   constexpr double cScale = 0.001;
+   constexpr double cOffset = 7.25;
+
+   std::vector<double> values;
+
+   for ( int i = -1000; i <= 1000; ++i )
+   {
+      // Halfway cases round up
+      values.push_back( i * 0.0005 );
+      values.push_back( i * 1234.5678 );
+   }
+
+   // Too big for the fast conversion, but fine for int64_t
+   values.push_back( 3.0e12 );
+   values.push_back( -3.0e12 );
+
+   std::vector<int64_t> rawValues( values.size() );
+
+   ASSERT_EQ( e57::unscaleValues( values.data(), values.size(), cScale, cOffset, rawValues.data() ),
+              values.size() );
+
+   for ( size_t i = 0; i < values.size(); ++i )
+   {
+      ASSERT_EQ( rawValues[i], static_cast<int64_t>( floor( ( values[i] - cOffset ) / cScale + 0.5 ) ) )
+         << "i: " << i;
+   }
+
+   // Report the first value which doesn't fit
+   values[9] = 1.0e30;
+   values[20] = -1.0e30;
+
+   EXPECT_EQ( e57::unscaleValues( values.data(), values.size(), cScale, cOffset, rawValues.data() ), 9 );
+}
@@ -0,0 +1,88 @@
+// libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "CRC32C.h"
+
+namespace
+{
+   // Straightforward bit-at-a-time CRC-32C to check against
+   uint32_t referenceCRC32C( const char *buf, size_t size )
+   {
+      uint32_t crc = 0xFFFFFFFF;
+
+      for ( size_t i = 0; i < size; ++i )
+      {
+         crc ^= static_cast<unsigned char>( buf[i] );
+
+         for ( int k = 0; k < 8; ++k )
+         {
+            crc = ( crc & 1 ) ? ( ( crc >> 1 ) ^ 0x82F63B78 ) : ( crc >> 1 );
+         }
+      }
+
+      return ~crc;
+   }
+}
+
+TEST( CRC32C, CheckValue )
+{
+   const char *data = "123456789";
+
+   ASSERT_EQ( e57::crc32c( data, strlen( data ) ), 0xE3069283 );
+   ASSERT_EQ( e57::crc32cPortable( data, strlen( data ) ), 0xE3069283 );
+}
+
+// Test vectors from RFC 3720 (iSCSI) section B.4
+TEST( CRC32C, RFC3720Vectors )
+{
+   std::array<char, 32> data;
+
+   data.fill( 0 );
+   EXPECT_EQ( e57::crc32c( data.data(), data.size() ), 0x8A9136AA );
+   EXPECT_EQ( e57::crc32cPortable( data.data(), data.size() ), 0x8A9136AA );
+
+   data.fill( static_cast<char>( 0xFF ) );
+   EXPECT_EQ( e57::crc32c( data.data(), data.size() ), 0x62A8AB43 );
+   EXPECT_EQ( e57::crc32cPortable( data.data(), data.size() ), 0x62A8AB43 );
+
+   for ( size_t i = 0; i < data.size(); ++i )
+   {
+      data[i] = static_cast<char>( i );
+   }
+   EXPECT_EQ( e57::crc32c( data.data(), data.size() ), 0x46DD794E );
+   EXPECT_EQ( e57::crc32cPortable( data.data(), data.size() ), 0x46DD794E );
+}
+
+// Cover all the paths through the implementations: short buffers, unaligned starts, and buffers long enough
+// to be split across lanes (such as a logical page). The portable version is checked too, since crc32c() only
+// uses it on CPUs without hardware support.
+TEST( CRC32C, MatchesReference )
+{
+   std::vector<char> data( 4096 );
+
+   uint32_t seed = 12345;
+   for ( auto &c : data )
+   {
+      seed = seed * 1103515245 + 12345;
+      c = static_cast<char>( seed >> 16 );
+   }
+
+   for ( size_t offset = 0; offset < 8; ++offset )
+   {
+      for ( size_t size : { 0, 1, 7, 8, 9, 63, 64, 1007, 1008, 1009, 1020, 2016, 3000, 4000 } )
+      {
+         const char *buf = data.data() + offset;
+
+         const uint32_t expected = referenceCRC32C( buf, size );
+
+         ASSERT_EQ( e57::crc32c( buf, size ), expected ) << "offset: " << offset << " size: " << size;
+         ASSERT_EQ( e57::crc32cPortable( buf, size ), expected ) << "offset: " << offset << " size: " << size;
+      }
+   }
+}
@@ -1,6 +1,10 @@
 // libE57Format testing Copyright © 2022 Andy Maloney <asmaloney@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
 #include "gtest/gtest.h"
 
 #include "E57SimpleReader.h"
@@ -19,6 +23,58 @@ namespace
       EXPECT_EQ( fileHeader.versionMajor, 1 );
       EXPECT_EQ( fileHeader.versionMinor, 0 );
    }
+
+   // Read all the points of ColouredCubeFloat.e57 using options, and check they match a read using the defaults
+   void CheckColouredCubeFloat( const e57::ReaderOptions &options )
+   {
+      const std::string cPath = TestData::Path() + "/self/ColouredCubeFloat.e57";
+
+      e57::Reader *plainReader = nullptr;
+      e57::Reader *reader = nullptr;
+
+      E57_ASSERT_NO_THROW( plainReader = new e57::Reader( cPath, {} ) );
+      E57_ASSERT_NO_THROW( reader = new e57::Reader( cPath, options ) );
+
+      ASSERT_TRUE( reader->IsOpen() );
+      ASSERT_EQ( reader->GetData3DCount(), 1 );
+
+      e57::Data3D data3DHeader;
+      ASSERT_TRUE( reader->ReadData3D( 0, data3DHeader ) );
+
+      ASSERT_EQ( data3DHeader.pointCount, 7'680 );
+
+      const uint64_t cNumPoints = data3DHeader.pointCount;
+
+      e57::Data3DPointsData plainPointsData( data3DHeader );
+      e57::Data3DPointsData pointsData( data3DHeader );
+
+      auto plainVectorReader = plainReader->SetUpData3DPointsData( 0, cNumPoints, plainPointsData );
+
+      ASSERT_EQ( plainVectorReader.read(), cNumPoints );
+
+      plainVectorReader.close();
+
+      auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, pointsData );
+
+      const uint64_t cNumRead = vectorReader.read();
+
+      vectorReader.close();
+
+      EXPECT_EQ( cNumRead, cNumPoints );
+
+      for ( uint64_t i = 0; i < cNumRead; ++i )
+      {
+         ASSERT_EQ( pointsData.cartesianX[i], plainPointsData.cartesianX[i] ) << "point: " << i;
+         ASSERT_EQ( pointsData.cartesianY[i], plainPointsData.cartesianY[i] ) << "point: " << i;
+         ASSERT_EQ( pointsData.cartesianZ[i], plainPointsData.cartesianZ[i] ) << "point: " << i;
+         ASSERT_EQ( pointsData.colorRed[i], plainPointsData.colorRed[i] ) << "point: " << i;
+         ASSERT_EQ( pointsData.colorGreen[i], plainPointsData.colorGreen[i] ) << "point: " << i;
+         ASSERT_EQ( pointsData.colorBlue[i], plainPointsData.colorBlue[i] ) << "point: " << i;
+      }
+
+      delete reader;
+      delete plainReader;
+   }
 }
 
 TEST( SimpleReader, PathError )
@@ -55,6 +111,169 @@ TEST( SimpleReaderData, DoNotCheckCRC )
    E57_ASSERT_NO_THROW( e57::Reader( TestData::Path() + "/self/bad-crc.e57", { e57::ChecksumPolicy::None } ) );
 }
 
+TEST( SimpleReaderData, BadCRCMemoryMapped )
+{
+   e57::ReaderOptions options;
+   options.memoryMapped = true;
+
+   E57_ASSERT_THROW( e57::Reader( TestData::Path() + "/self/bad-crc.e57", options ) );
+}
+
+TEST( SimpleReaderData, ColouredCubeFloatMemoryMapped )
+{
+   e57::ReaderOptions options;
+   options.memoryMapped = true;
+
+   CheckColouredCubeFloat( options );
+}
+
+TEST( SimpleReaderData, ColouredCubeFloatReadAhead )
+{
+   e57::ReaderOptions options;
+   options.readAheadPacketCount = 4;
+
+   CheckColouredCubeFloat( options );
+}
+
+TEST( SimpleReaderData, ColouredCubeFloatSharedPacketCache )
+{
+   e57::ReaderOptions options;
+   options.packetCacheSize = 0; // a single packet
+
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( TestData::Path() + "/self/ColouredCubeFloat.e57", options ) );
+
+   ASSERT_TRUE( reader->IsOpen() );
+
+   e57::Data3D data3DHeader;
+   ASSERT_TRUE( reader->ReadData3D( 0, data3DHeader ) );
+
+   const uint64_t cNumPoints = data3DHeader.pointCount;
+
+   e57::Data3DPointsData pointsData1( data3DHeader );
+   e57::Data3DPointsData pointsData2( data3DHeader );
+
+   // The second reader uses the same cache as the first
+   auto vectorReader1 = reader->SetUpData3DPointsData( 0, cNumPoints, pointsData1 );
+
+   EXPECT_EQ( vectorReader1.read(), cNumPoints );
+
+   vectorReader1.close();
+
+   auto vectorReader2 = reader->SetUpData3DPointsData( 0, cNumPoints, pointsData2 );
+
+   EXPECT_EQ( vectorReader2.read(), cNumPoints );
+
+   vectorReader2.close();
+
+   for ( uint64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_EQ( pointsData1.cartesianX[i], pointsData2.cartesianX[i] );
+      ASSERT_EQ( pointsData1.colorRed[i], pointsData2.colorRed[i] );
+   }
+
+   delete reader;
+}
+
+// This file has no index packets, so seeking has to walk the data packets
+TEST( SimpleReaderData, ColouredCubeFloatSeek )
+{
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( TestData::Path() + "/self/ColouredCubeFloat.e57", {} ) );
+
+   ASSERT_TRUE( reader->IsOpen() );
+
+   e57::Data3D data3DHeader;
+   ASSERT_TRUE( reader->ReadData3D( 0, data3DHeader ) );
+
+   const uint64_t cNumPoints = data3DHeader.pointCount;
+
+   e57::Data3DPointsData allPointsData( data3DHeader );
+
+   auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, allPointsData );
+
+   EXPECT_EQ( vectorReader.read(), cNumPoints );
+
+   vectorReader.close();
+
+   constexpr uint64_t cNumSeekPoints = 100;
+
+   e57::Data3DPointsData seekPointsData( data3DHeader );
+
+   auto seekReader = reader->SetUpData3DPointsData( 0, cNumSeekPoints, seekPointsData );
+
+   for ( const uint64_t seekTo : { uint64_t{ 5'000 }, uint64_t{ 1 }, cNumPoints - 50, uint64_t{ 2'345 } } )
+   {
+      E57_ASSERT_NO_THROW( seekReader.seek( static_cast<int64_t>( seekTo ) ) );
+
+      const uint64_t cNumRead = seekReader.read();
+
+      ASSERT_EQ( cNumRead, std::min( cNumSeekPoints, cNumPoints - seekTo ) );
+
+      for ( uint64_t i = 0; i < cNumRead; ++i )
+      {
+         ASSERT_EQ( seekPointsData.cartesianX[i], allPointsData.cartesianX[seekTo + i] );
+         ASSERT_EQ( seekPointsData.cartesianZ[i], allPointsData.cartesianZ[seekTo + i] );
+         ASSERT_EQ( seekPointsData.colorGreen[i], allPointsData.colorGreen[seekTo + i] );
+      }
+   }
+
+   seekReader.close();
+
+   delete reader;
+}
+
+// Seek using a packet index saved in a sidecar file by the first reader & loaded by the second
+TEST( SimpleReaderData, ColouredCubeFloatSeekSidecarIndex )
+{
+   const std::string cSidecarPath = "./ColouredCubeFloat.e57pi";
+
+   std::remove( cSidecarPath.c_str() );
+
+   e57::ReaderOptions options;
+   options.packetIndexPath = cSidecarPath;
+
+   constexpr uint64_t cNumSeekPoints = 100;
+   constexpr uint64_t cSeekTo = 6'000;
+
+   float cartesianX[2][cNumSeekPoints];
+
+   for ( int pass = 0; pass < 2; ++pass )
+   {
+      e57::Reader *reader = nullptr;
+
+      E57_ASSERT_NO_THROW( reader = new e57::Reader( TestData::Path() + "/self/ColouredCubeFloat.e57", options ) );
+
+      ASSERT_TRUE( reader->IsOpen() );
+
+      e57::Data3D data3DHeader;
+      ASSERT_TRUE( reader->ReadData3D( 0, data3DHeader ) );
+
+      e57::Data3DPointsData pointsData( data3DHeader );
+
+      auto vectorReader = reader->SetUpData3DPointsData( 0, cNumSeekPoints, pointsData );
+
+      E57_ASSERT_NO_THROW( vectorReader.seek( cSeekTo ) );
+
+      ASSERT_EQ( vectorReader.read(), cNumSeekPoints );
+
+      vectorReader.close();
+
+      std::copy_n( pointsData.cartesianX, cNumSeekPoints, cartesianX[pass] );
+
+      delete reader;
+
+      ASSERT_TRUE( std::ifstream( cSidecarPath ).good() );
+   }
+
+   for ( uint64_t i = 0; i < cNumSeekPoints; ++i )
+   {
+      ASSERT_EQ( cartesianX[0][i], cartesianX[1][i] );
+   }
+}
+
 // https://github.com/asmaloney/libE57Format/issues/26
 TEST( SimpleReaderData, ChineseFileName )
 {
@@ -3,9 +3,13 @@
 
 #include <array>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 
 #include "gtest/gtest.h"
 
+#include "E57SimpleReader.h"
 #include "E57SimpleWriter.h"
 
 #include "Helpers.h"
@@ -124,6 +128,69 @@ namespace
          }
       }
    }
+
+   // Write enough cartesian points to need many data packets to inPath using options, then read them back and
+   // check them.
+   void writeAndCheckCartesianPoints( const std::string &inPath, const e57::WriterOptions &options )
+   {
+      e57::Writer *writer = nullptr;
+
+      E57_ASSERT_NO_THROW( writer = new e57::Writer( inPath, options ) );
+
+      constexpr int64_t cNumPoints = 100000;
+
+      e57::Data3D header;
+      header.guid = "Cartesian Points Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      const int64_t scanIndex = writer->NewData3D( header );
+
+      e57::Data3DPointsData pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         auto floati = static_cast<float>( i );
+         pointsData.cartesianX[i] = floati;
+         pointsData.cartesianY[i] = -floati;
+         pointsData.cartesianZ[i] = floati * 0.5F;
+      }
+
+      e57::CompressedVectorWriter dataWriter = writer->SetUpData3DPointsData( scanIndex, cNumPoints, pointsData );
+
+      E57_ASSERT_NO_THROW( dataWriter.write( cNumPoints ) );
+      E57_ASSERT_NO_THROW( dataWriter.close() );
+
+      delete writer;
+
+      e57::Reader *reader = nullptr;
+
+      E57_ASSERT_NO_THROW( reader = new e57::Reader( inPath, {} ) );
+
+      e57::Data3D readHeader;
+      ASSERT_TRUE( reader->ReadData3D( 0, readHeader ) );
+      ASSERT_EQ( readHeader.pointCount, cNumPoints );
+
+      e57::Data3DPointsData readPointsData( readHeader );
+
+      auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, readPointsData );
+
+      ASSERT_EQ( vectorReader.read(), cNumPoints );
+
+      vectorReader.close();
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         auto floati = static_cast<float>( i );
+         ASSERT_EQ( readPointsData.cartesianX[i], floati );
+         ASSERT_EQ( readPointsData.cartesianY[i], -floati );
+         ASSERT_EQ( readPointsData.cartesianZ[i], floati * 0.5F );
+      }
+
+      delete reader;
+   }
 }
 
 TEST( SimpleWriter, PathError )
@@ -380,6 +447,219 @@ TEST( SimpleWriter, MultipleScans )
    delete writer;
 }
 
+// Read all the scans of a file at the same time, each on its own thread.
+TEST( SimpleWriter, MultipleScansReadInParallel )
+{
+   e57::WriterOptions options;
+   options.guid = "Multiple Scans Read In Parallel File GUID";
+
+   e57::Writer *writer = nullptr;
+
+   E57_ASSERT_NO_THROW( writer = new e57::Writer( "./MultipleScansReadInParallel.e57", options ) );
+
+   // enough points to need several data packets per scan
+   constexpr int cNumScans = 4;
+   constexpr int64_t cNumPoints = 50000;
+
+   auto pointValue = []( int scan, int64_t i ) { return static_cast<float>( scan * cNumPoints + i ); };
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      e57::Data3D header;
+      header.guid = "Multiple Scans Read In Parallel Scan " + std::to_string( scan ) + " Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      const int64_t scanIndex = writer->NewData3D( header );
+
+      e57::Data3DPointsData pointsData( header );
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         pointsData.cartesianX[i] = pointValue( scan, i );
+         pointsData.cartesianY[i] = -pointValue( scan, i );
+         pointsData.cartesianZ[i] = pointValue( scan, i ) * 0.5F;
+      }
+
+      e57::CompressedVectorWriter dataWriter = writer->SetUpData3DPointsData( scanIndex, cNumPoints, pointsData );
+
+      dataWriter.write( cNumPoints );
+      dataWriter.close();
+   }
+
+   delete writer;
+
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./MultipleScansReadInParallel.e57", {} ) );
+
+   ASSERT_EQ( reader->GetData3DCount(), cNumScans );
+
+   std::vector<e57::Data3D> headers( cNumScans );
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      ASSERT_TRUE( reader->ReadData3D( scan, headers[scan] ) );
+   }
+
+   // Each thread counts the points it read back correctly
+   std::vector<int64_t> numGood( cNumScans, 0 );
+   std::vector<std::thread> threads;
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      threads.emplace_back( [&, scan] {
+         constexpr int64_t cBatchSize = 1000;
+
+         e57::Data3DPointsData pointsData( headers[scan] );
+
+         auto vectorReader = reader->SetUpData3DPointsData( scan, cBatchSize, pointsData );
+
+         int64_t start = 0;
+
+         while ( const int64_t numRead = vectorReader.read() )
+         {
+            for ( int64_t i = 0; i < numRead; ++i )
+            {
+               if ( ( pointsData.cartesianX[i] == pointValue( scan, start + i ) ) &&
+                    ( pointsData.cartesianY[i] == -pointValue( scan, start + i ) ) &&
+                    ( pointsData.cartesianZ[i] == pointValue( scan, start + i ) * 0.5F ) )
+               {
+                  ++numGood[scan];
+               }
+            }
+
+            start += numRead;
+         }
+
+         vectorReader.close();
+      } );
+   }
+
+   for ( auto &thread : threads )
+   {
+      thread.join();
+   }
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      EXPECT_EQ( numGood[scan], cNumPoints );
+   }
+
+   delete reader;
+}
+
+TEST( SimpleWriter, MultipleScansWrittenInParallel )
+{
+   e57::WriterOptions options;
+   options.guid = "Multiple Scans Written In Parallel File GUID";
+
+   e57::Writer *writer = nullptr;
+
+   E57_ASSERT_NO_THROW( writer = new e57::Writer( "./MultipleScansWrittenInParallel.e57", options ) );
+
+   // enough points to need several data packets per scan
+   constexpr int cNumScans = 4;
+   constexpr int64_t cNumPoints = 50000;
+   constexpr int64_t cBatchSize = 1000;
+
+   auto pointValue = []( int scan, int64_t i ) { return static_cast<float>( scan * cNumPoints + i ); };
+
+   std::vector<e57::Data3D> headers( cNumScans );
+   std::vector<std::unique_ptr<e57::Data3DPointsData>> pointsData;
+   std::vector<e57::CompressedVectorWriter> dataWriters;
+
+   // All the writers are open at the same time
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      e57::Data3D &header = headers[scan];
+      header.guid = "Multiple Scans Written In Parallel Scan " + std::to_string( scan ) + " Header GUID";
+      header.pointCount = cNumPoints;
+      header.pointFields.cartesianXField = true;
+      header.pointFields.cartesianYField = true;
+      header.pointFields.cartesianZField = true;
+
+      const int64_t scanIndex = writer->NewData3D( header );
+
+      pointsData.emplace_back( new e57::Data3DPointsData( header ) );
+
+      dataWriters.push_back( writer->SetUpData3DPointsData( scanIndex, cBatchSize, *pointsData.back() ) );
+   }
+
+   EXPECT_EQ( writer->GetRawIMF().writerCount(), cNumScans );
+
+   std::vector<std::thread> threads;
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      threads.emplace_back( [&, scan] {
+         for ( int64_t start = 0; start < cNumPoints; start += cBatchSize )
+         {
+            for ( int64_t i = 0; i < cBatchSize; ++i )
+            {
+               pointsData[scan]->cartesianX[i] = pointValue( scan, start + i );
+               pointsData[scan]->cartesianY[i] = -pointValue( scan, start + i );
+               pointsData[scan]->cartesianZ[i] = pointValue( scan, start + i ) * 0.5F;
+            }
+
+            dataWriters[scan].write( cBatchSize );
+         }
+
+         dataWriters[scan].close();
+      } );
+   }
+
+   for ( auto &thread : threads )
+   {
+      thread.join();
+   }
+
+   EXPECT_EQ( writer->GetRawIMF().writerCount(), 0 );
+
+   dataWriters.clear();
+
+   delete writer;
+
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./MultipleScansWrittenInParallel.e57", {} ) );
+
+   ASSERT_EQ( reader->GetData3DCount(), cNumScans );
+
+   for ( int scan = 0; scan < cNumScans; ++scan )
+   {
+      e57::Data3D header;
+      ASSERT_TRUE( reader->ReadData3D( scan, header ) );
+      ASSERT_EQ( header.pointCount, cNumPoints );
+
+      e57::Data3DPointsData readData( header );
+
+      auto vectorReader = reader->SetUpData3DPointsData( scan, cNumPoints, readData );
+
+      ASSERT_EQ( vectorReader.read(), cNumPoints );
+
+      int64_t numGood = 0;
+
+      for ( int64_t i = 0; i < cNumPoints; ++i )
+      {
+         if ( ( readData.cartesianX[i] == pointValue( scan, i ) ) &&
+              ( readData.cartesianY[i] == -pointValue( scan, i ) ) &&
+              ( readData.cartesianZ[i] == pointValue( scan, i ) * 0.5F ) )
+         {
+            ++numGood;
+         }
+      }
+
+      EXPECT_EQ( numGood, cNumPoints );
+
+      vectorReader.close();
+   }
+
+   delete reader;
+}
+
 // https://github.com/asmaloney/libE57Format/issues/26
 TEST( SimpleWriter, ChineseFileName )
 {
@@ -436,6 +716,359 @@ TEST( SimpleWriter, CartesianPoints )
    delete writer;
 }
 
+TEST( SimpleWriter, CartesianPointsBackgroundWrite )
+{
+   e57::WriterOptions options;
+   options.guid = "Cartesian Points Background Write File GUID";
+   options.backgroundWrite = true;
+
+   writeAndCheckCartesianPoints( "./CartesianPointsBackgroundWrite.e57", options );
+}
+
+TEST( SimpleWriter, CartesianPointsParallelEncode )
+{
+   // Encode the bytestreams in parallel, running the tasks on this thread so we can count them
+   int taskCount = 0;
+
+   e57::WriterOptions options;
+   options.guid = "Cartesian Points Parallel Encode File GUID";
+   options.encodeThreadCount = 3;
+   options.encodeExecutor = [&taskCount]( std::function<void()> task ) {
+      ++taskCount;
+      task();
+   };
+
+   writeAndCheckCartesianPoints( "./CartesianPointsParallelEncode.e57", options );
+
+   EXPECT_GT( taskCount, 0 );
+}
+
+// Write in uneven batches so the chunks recorded in the index packets don't line up with the calls to write(),
+// then make sure it all reads back & that we can seek to any record.
+TEST( SimpleWriter, ScaledIntPointsInBatches )
+{
+   e57::WriterOptions options;
+   options.guid = "Scaled Int Points In Batches File GUID";
+
+   e57::Writer *writer = nullptr;
+
+   E57_ASSERT_NO_THROW( writer = new e57::Writer( "./ScaledIntPointsInBatches.e57", options ) );
+
+   // enough points to need many data packets
+   constexpr int64_t cNumPoints = 200000;
+   constexpr int64_t cBatchSize = 777;
+
+   e57::Data3D header;
+   header.guid = "Scaled Int Points In Batches Header GUID";
+   header.pointCount = cNumPoints;
+   header.pointFields.cartesianXField = true;
+   header.pointFields.cartesianYField = true;
+   header.pointFields.cartesianZField = true;
+   header.pointFields.pointRangeScaledInteger = 0.001;
+   header.pointFields.pointRangeMinimum = -1000.0;
+   header.pointFields.pointRangeMaximum = 1000.0;
+
+   const int64_t scanIndex = writer->NewData3D( header );
+
+   e57::Data3DPointsData_d pointsData( header );
+
+   auto pointValue = []( int64_t i, int axis ) {
+      return static_cast<double>( ( i * ( axis + 3 ) ) % 2000000 ) * 0.001 - 1000.0;
+   };
+
+   e57::CompressedVectorWriter dataWriter = writer->SetUpData3DPointsData( scanIndex, cBatchSize, pointsData );
+
+   for ( int64_t start = 0; start < cNumPoints; start += cBatchSize )
+   {
+      const int64_t count = std::min( cBatchSize, cNumPoints - start );
+
+      for ( int64_t i = 0; i < count; ++i )
+      {
+         pointsData.cartesianX[i] = pointValue( start + i, 0 );
+         pointsData.cartesianY[i] = pointValue( start + i, 1 );
+         pointsData.cartesianZ[i] = pointValue( start + i, 2 );
+      }
+
+      E57_ASSERT_NO_THROW( dataWriter.write( static_cast<size_t>( count ) ) );
+   }
+
+   E57_ASSERT_NO_THROW( dataWriter.close() );
+
+   delete writer;
+
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./ScaledIntPointsInBatches.e57", {} ) );
+
+   e57::Data3D readHeader;
+   ASSERT_TRUE( reader->ReadData3D( 0, readHeader ) );
+   ASSERT_EQ( readHeader.pointCount, cNumPoints );
+
+   e57::Data3DPointsData_d readPointsData( readHeader );
+
+   auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, readPointsData );
+
+   const uint64_t cNumRead = vectorReader.read();
+
+   vectorReader.close();
+
+   ASSERT_EQ( cNumRead, cNumPoints );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      ASSERT_NEAR( readPointsData.cartesianX[i], pointValue( i, 0 ), 0.0005 );
+      ASSERT_NEAR( readPointsData.cartesianY[i], pointValue( i, 1 ), 0.0005 );
+      ASSERT_NEAR( readPointsData.cartesianZ[i], pointValue( i, 2 ), 0.0005 );
+   }
+
+   // Seek around using the index packets
+   e57::Data3DPointsData_d seekPointsData( readHeader );
+
+   auto seekReader = reader->SetUpData3DPointsData( 0, cBatchSize, seekPointsData );
+
+   for ( const int64_t seekTo : { int64_t{ 150000 }, int64_t{ 3 }, cNumPoints - 10, int64_t{ 77777 }, cNumPoints } )
+   {
+      E57_ASSERT_NO_THROW( seekReader.seek( seekTo ) );
+
+      const int64_t numRead = seekReader.read();
+
+      ASSERT_EQ( numRead, std::min( cBatchSize, cNumPoints - seekTo ) );
+
+      for ( int64_t i = 0; i < numRead; ++i )
+      {
+         ASSERT_NEAR( seekPointsData.cartesianX[i], pointValue( seekTo + i, 0 ), 0.0005 );
+         ASSERT_NEAR( seekPointsData.cartesianY[i], pointValue( seekTo + i, 1 ), 0.0005 );
+         ASSERT_NEAR( seekPointsData.cartesianZ[i], pointValue( seekTo + i, 2 ), 0.0005 );
+      }
+   }
+
+   seekReader.close();
+
+   delete reader;
+
+   // Read it again in small batches, sharing the bytestreams of each packet out between tasks run on this thread
+   int taskCount = 0;
+
+   e57::ReaderOptions readerOptions;
+   readerOptions.decodeThreadCount = 3;
+   readerOptions.decodeExecutor = [&taskCount]( std::function<void()> task ) {
+      ++taskCount;
+      task();
+   };
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./ScaledIntPointsInBatches.e57", readerOptions ) );
+
+   e57::Data3DPointsData_d batchPointsData( readHeader );
+
+   auto batchReader = reader->SetUpData3DPointsData( 0, cBatchSize, batchPointsData );
+
+   int64_t start = 0;
+
+   while ( const int64_t numRead = batchReader.read() )
+   {
+      for ( int64_t i = 0; i < numRead; ++i )
+      {
+         ASSERT_NEAR( batchPointsData.cartesianX[i], pointValue( start + i, 0 ), 0.0005 );
+         ASSERT_NEAR( batchPointsData.cartesianY[i], pointValue( start + i, 1 ), 0.0005 );
+         ASSERT_NEAR( batchPointsData.cartesianZ[i], pointValue( start + i, 2 ), 0.0005 );
+      }
+
+      start += numRead;
+   }
+
+   batchReader.close();
+
+   EXPECT_EQ( start, cNumPoints );
+   EXPECT_GT( taskCount, 0 );
+
+   delete reader;
+}
+
+TEST( SimpleWriter, ColouredCartesianPointsRecordAligned )
+{
+   e57::WriterOptions options;
+   options.guid = "Coloured Cartesian Points Record Aligned File GUID";
+   options.chunkRecordCount = 1000; // rounded up to 1024
+
+   e57::Writer *writer = nullptr;
+
+   E57_ASSERT_NO_THROW( writer = new e57::Writer( "./ColouredCartesianPointsRecordAligned.e57", options ) );
+
+   constexpr int64_t cNumPoints = 50000;
+   constexpr int64_t cBatchSize = 3000;
+
+   e57::Data3D header;
+   header.guid = "Coloured Cartesian Points Record Aligned Header GUID";
+   header.pointCount = cNumPoints;
+
+   setUsingColouredCartesianPoints( header );
+
+   const int64_t scanIndex = writer->NewData3D( header );
+
+   e57::Data3DPointsData pointsData( header );
+
+   e57::CompressedVectorWriter dataWriter = writer->SetUpData3DPointsData( scanIndex, cBatchSize, pointsData );
+
+   for ( int64_t start = 0; start < cNumPoints; start += cBatchSize )
+   {
+      const int64_t count = std::min( cBatchSize, cNumPoints - start );
+
+      for ( int64_t i = 0; i < count; ++i )
+      {
+         auto floati = static_cast<float>( start + i );
+         pointsData.cartesianX[i] = floati;
+         pointsData.cartesianY[i] = -floati;
+         pointsData.cartesianZ[i] = floati * 0.5F;
+
+         pointsData.colorRed[i] = static_cast<uint8_t>( start + i );
+         pointsData.colorGreen[i] = 0;
+         pointsData.colorBlue[i] = 255;
+      }
+
+      E57_ASSERT_NO_THROW( dataWriter.write( static_cast<size_t>( count ) ) );
+   }
+
+   E57_ASSERT_NO_THROW( dataWriter.close() );
+
+   delete writer;
+
+   e57::Reader *reader = nullptr;
+
+   // Decode the chunks in parallel, running the tasks on this thread so we can count them
+   int taskCount = 0;
+
+   e57::ReaderOptions readerOptions;
+   readerOptions.decodeThreadCount = 4;
+   readerOptions.decodeExecutor = [&taskCount]( std::function<void()> task ) {
+      ++taskCount;
+      task();
+   };
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./ColouredCartesianPointsRecordAligned.e57", readerOptions ) );
+
+   e57::Data3D readHeader;
+   ASSERT_TRUE( reader->ReadData3D( 0, readHeader ) );
+   ASSERT_EQ( readHeader.pointCount, cNumPoints );
+
+   e57::Data3DPointsData readPointsData( readHeader );
+
+   auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, readPointsData );
+
+   ASSERT_EQ( vectorReader.read(), cNumPoints );
+
+   vectorReader.close();
+
+   EXPECT_EQ( taskCount, 4 );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      auto floati = static_cast<float>( i );
+      ASSERT_EQ( readPointsData.cartesianX[i], floati );
+      ASSERT_EQ( readPointsData.cartesianY[i], -floati );
+      ASSERT_EQ( readPointsData.cartesianZ[i], floati * 0.5F );
+      ASSERT_EQ( readPointsData.colorRed[i], static_cast<uint8_t>( i ) );
+   }
+
+   constexpr int64_t cNumSeekPoints = 100;
+
+   e57::Data3DPointsData seekPointsData( readHeader );
+
+   auto seekReader = reader->SetUpData3DPointsData( 0, cNumSeekPoints, seekPointsData );
+
+   // at, just before & just after chunk boundaries
+   for ( const int64_t seekTo : { int64_t{ 1024 * 30 }, int64_t{ 0 }, int64_t{ 1024 * 7 - 1 }, int64_t{ 1024 + 1 },
+                                  cNumPoints - 1 } )
+   {
+      E57_ASSERT_NO_THROW( seekReader.seek( seekTo ) );
+
+      const int64_t numRead = seekReader.read();
+
+      ASSERT_EQ( numRead, std::min( cNumSeekPoints, cNumPoints - seekTo ) );
+
+      for ( int64_t i = 0; i < numRead; ++i )
+      {
+         auto floati = static_cast<float>( seekTo + i );
+         ASSERT_EQ( seekPointsData.cartesianX[i], floati );
+         ASSERT_EQ( seekPointsData.cartesianY[i], -floati );
+         ASSERT_EQ( seekPointsData.cartesianZ[i], floati * 0.5F );
+         ASSERT_EQ( seekPointsData.colorRed[i], static_cast<uint8_t>( seekTo + i ) );
+         ASSERT_EQ( seekPointsData.colorBlue[i], 255 );
+      }
+   }
+
+   seekReader.close();
+
+   delete reader;
+}
+
+// An executor which runs each task & then throws must not leave read() waiting for the task to finish again
+TEST( SimpleWriter, ColouredCartesianPointsDecodeExecutorThrows )
+{
+   e57::WriterOptions options;
+   options.guid = "Coloured Cartesian Points Decode Executor Throws File GUID";
+   options.chunkRecordCount = 1024;
+
+   e57::Writer *writer = nullptr;
+
+   E57_ASSERT_NO_THROW( writer = new e57::Writer( "./DecodeExecutorThrows.e57", options ) );
+
+   constexpr int64_t cNumPoints = 8192;
+
+   e57::Data3D header;
+   header.guid = "Coloured Cartesian Points Decode Executor Throws Header GUID";
+   header.pointCount = cNumPoints;
+
+   setUsingColouredCartesianPoints( header );
+
+   const int64_t scanIndex = writer->NewData3D( header );
+
+   e57::Data3DPointsData pointsData( header );
+
+   for ( int64_t i = 0; i < cNumPoints; ++i )
+   {
+      auto floati = static_cast<float>( i );
+      pointsData.cartesianX[i] = floati;
+      pointsData.cartesianY[i] = -floati;
+      pointsData.cartesianZ[i] = floati * 0.5F;
+   }
+
+   e57::CompressedVectorWriter dataWriter = writer->SetUpData3DPointsData( scanIndex, cNumPoints, pointsData );
+
+   E57_ASSERT_NO_THROW( dataWriter.write( cNumPoints ) );
+   E57_ASSERT_NO_THROW( dataWriter.close() );
+
+   delete writer;
+
+   int taskCount = 0;
+
+   e57::ReaderOptions readerOptions;
+   readerOptions.decodeThreadCount = 2;
+   readerOptions.decodeExecutor = [&taskCount]( std::function<void()> task ) {
+      ++taskCount;
+      task();
+      throw std::runtime_error( "executor failed" );
+   };
+
+   e57::Reader *reader = nullptr;
+
+   E57_ASSERT_NO_THROW( reader = new e57::Reader( "./DecodeExecutorThrows.e57", readerOptions ) );
+
+   e57::Data3D readHeader;
+   ASSERT_TRUE( reader->ReadData3D( 0, readHeader ) );
+
+   e57::Data3DPointsData readPointsData( readHeader );
+
+   auto vectorReader = reader->SetUpData3DPointsData( 0, cNumPoints, readPointsData );
+
+   ASSERT_THROW( vectorReader.read(), std::runtime_error );
+
+   EXPECT_GT( taskCount, 0 );
+
+   vectorReader.close();
+
+   delete reader;
+}
+
 TEST( SimpleWriter, ColouredCartesianPoints )
 {
    e57::WriterOptions options;